@@ -0,0 +1,279 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the binary scheme format.
+ * @file binaryscheme.cpp
+ *
+ *
+ */
+
+#include "binaryscheme.h"
+#include "scene.h"
+
+#include <QFile>
+#include <QtEndian>
+#include <QtMath>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+const char BinaryScheme::Magic[8] = { 'B', 'E', 'S', 'C', 'H', 'E', 'M', 'E' };
+const char* BinaryScheme::Suffix = "bsch";
+
+static const int HeaderSize = 32;
+static const int BlockRecordSize = 16;
+static const int EdgeRecordSize = 12;
+static const int TileRecordSize = 16;
+static const int ValueRecordSize = 12;
+
+static qint32 readInt(const uchar* data, int index)
+{
+    return qFromLittleEndian<qint32>(data + 4*index);
+}
+
+static void appendInt(QByteArray* buffer, qint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<qint32>(value, bytes);
+    buffer->append((const char*)bytes, 4);
+}
+
+static double readDouble(const uchar* data)
+{
+    quint64 bits = qFromLittleEndian<quint64>(data);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void appendDouble(QByteArray* buffer, double value)
+{
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uchar bytes[8];
+    qToLittleEndian<quint64>(bits, bytes);
+    buffer->append((const char*)bytes, 8);
+}
+
+bool BinaryScheme::isBinaryFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    char magic[sizeof(Magic)];
+    return file.read(magic, sizeof(Magic)) == qint64(sizeof(Magic)) &&
+           memcmp(magic, Magic, sizeof(Magic)) == 0;
+}
+
+bool BinaryScheme::read(const QString &fileName, Scene* scene, QString* error, QString* warning)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    qint64 size = file.size();
+    if (size < HeaderSize) {
+        *error = "File is corrupted.";
+        return false;
+    }
+    const uchar* data = file.map(0, size);
+    if (!data) {
+        *error = file.errorString();
+        return false;
+    }
+
+    // Check the whole file before anything is built
+    quint32 version = qFromLittleEndian<quint32>(data + 8);
+    qint64 blockCount = qFromLittleEndian<quint32>(data + 12);
+    qint64 edgeCount = qFromLittleEndian<quint32>(data + 16);
+    qint32 tileSize = version >= 2 ? qFromLittleEndian<qint32>(data + 20) : 0;
+    qint64 tileCount = version >= 2 ? qFromLittleEndian<quint32>(data + 24) : 0;
+    qint64 valueCount = version >= 3 ? qFromLittleEndian<quint32>(data + 28) : 0;
+    if (memcmp(data, Magic, sizeof(Magic)) != 0 || version < 1 || version > Version ||
+        (version >= 2 && tileSize <= 0) ||
+        size != HeaderSize + blockCount*BlockRecordSize + edgeCount*EdgeRecordSize + tileCount*TileRecordSize +
+                valueCount*ValueRecordSize) {
+        *error = "File is corrupted.";
+        return false;
+    }
+
+    const uchar* blocks = data + HeaderSize;
+    for (qint64 i = 0; i < blockCount; i++) {
+        const uchar* record = blocks + i*BlockRecordSize;
+        qint32 type = readInt(record, 0);
+        if (type < Block::Add || type > Block::Output || readInt(record, 1) < 0) {
+            *error = "File is corrupted.";
+            return false;
+        }
+    }
+
+    // The tiles must cover the blocks one after another
+    const uchar* edges = blocks + blockCount*BlockRecordSize;
+    const uchar* tiles = edges + edgeCount*EdgeRecordSize;
+    qint64 tiled = 0;
+    for (qint64 i = 0; i < tileCount; i++) {
+        const uchar* record = tiles + i*TileRecordSize;
+        if (readInt(record, 2) != tiled || readInt(record, 3) < 0) {
+            *error = "File is corrupted.";
+            return false;
+        }
+        tiled += readInt(record, 3);
+    }
+    if (version >= 2 && tiled != blockCount) {
+        *error = "File is corrupted.";
+        return false;
+    }
+
+    if (version >= 2) {
+        // Only the model gets the blocks now, their items are created when their tile is shown
+        scene->setTileSize(tileSize);
+        for (qint64 i = 0; i < blockCount; i++) {
+            const uchar* record = blocks + i*BlockRecordSize;
+            if (!scene->loadModelBlock(Block::blockType(readInt(record, 0)), readInt(record, 1),
+                                       readInt(record, 2), readInt(record, 3))) {
+                *error = "File is corrupted.";
+                return false;
+            }
+        }
+        for (qint64 i = 0; i < tileCount; i++) {
+            const uchar* record = tiles + i*TileRecordSize;
+            QVector<int> ids(readInt(record, 3));
+            for (int j = 0; j < ids.size(); j++)
+                ids[j] = readInt(blocks + (readInt(record, 2) + j)*BlockRecordSize, 1);
+            scene->loadTile(readInt(record, 0), readInt(record, 1), ids);
+        }
+    }
+    else {
+        for (qint64 i = 0; i < blockCount; i++) {
+            const uchar* record = blocks + i*BlockRecordSize;
+            if (!scene->loadBlock(Block::blockType(readInt(record, 0)), readInt(record, 1),
+                                  readInt(record, 2), readInt(record, 3))) {
+                *error = "File is corrupted.";
+                return false;
+            }
+        }
+    }
+
+    // A refused connection is left out like in the text format, the rest of the scheme is kept
+    qint64 skipped = 0;
+    for (qint64 i = 0; i < edgeCount; i++) {
+        const uchar* record = edges + i*EdgeRecordSize;
+        if (!scene->loadConnection(readInt(record, 0), readInt(record, 1), readInt(record, 2)))
+            skipped++;
+    }
+
+    const uchar* values = tiles + tileCount*TileRecordSize;
+    for (qint64 i = 0; i < valueCount; i++) {
+        const uchar* record = values + i*ValueRecordSize;
+        if (!scene->loadInputValue(readInt(record, 0), readDouble(record + 4))) {
+            *error = "File is corrupted.";
+            return false;
+        }
+    }
+    if (skipped > 0 && warning)
+        *warning = QString("%1 connection(s) were left out because they form a loop, connect a taken port "
+                           "or a missing block.").arg(skipped);
+
+    file.unmap((uchar*)data);
+    return true;
+}
+
+bool BinaryScheme::write(const SchemeModel* model, const QString &fileName, QString* error, QAtomicInt* progress)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    // Blocks are stored tile by tile, ordered by row and column of their tile
+    std::vector<std::pair<qint64, int> > order;
+    order.reserve(model->blockCount());
+    for (int slot = 0; slot < model->slotCount(); slot++) {
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        if (block.id < 0)
+            continue;
+        qint64 row = qFloor(double(block.y) / TileSize);
+        qint64 column = qFloor(double(block.x) / TileSize);
+        order.push_back(std::make_pair(row * (Q_INT64_C(1) << 32) + column, slot));
+    }
+    std::sort(order.begin(), order.end());
+
+    QByteArray values;
+    int valueCount = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        const SchemeModel::BlockRecord& block = model->blockAt(order[i].second);
+        if (block.type != SchemeModel::Input || !block.inputSet)
+            continue;
+        appendInt(&values, block.id);
+        appendDouble(&values, block.inputValue);
+        valueCount++;
+    }
+
+    QByteArray tiles;
+    int tileCount = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i > 0 && order[i].first == order[i-1].first)
+            continue;
+        size_t end = i;
+        while (end < order.size() && order[end].first == order[i].first)
+            end++;
+        const SchemeModel::BlockRecord& block = model->blockAt(order[i].second);
+        appendInt(&tiles, qFloor(double(block.x) / TileSize));
+        appendInt(&tiles, qFloor(double(block.y) / TileSize));
+        appendInt(&tiles, int(i));
+        appendInt(&tiles, int(end - i));
+        tileCount++;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(HeaderSize + model->blockCount()*BlockRecordSize + model->edgeCount()*EdgeRecordSize +
+                   tiles.size() + values.size());
+    buffer.append(Magic, sizeof(Magic));
+    appendInt(&buffer, Version);
+    appendInt(&buffer, model->blockCount());
+    appendInt(&buffer, model->edgeCount());
+    appendInt(&buffer, TileSize);
+    appendInt(&buffer, tileCount);
+    appendInt(&buffer, valueCount);
+    buffer.append(HeaderSize - buffer.size(), '\0');
+
+    for (size_t i = 0; i < order.size(); i++) {
+        const SchemeModel::BlockRecord& block = model->blockAt(order[i].second);
+        appendInt(&buffer, block.type);
+        appendInt(&buffer, block.id);
+        appendInt(&buffer, block.x);
+        appendInt(&buffer, block.y);
+        if (progress && (i & 4095) == 0)
+            progress->storeRelease(int(qint64(i) * 50 / order.size()));
+    }
+    for (int slot = 0; slot < model->slotCount(); slot++) {
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        if (block.id < 0)
+            continue;
+        for (size_t i = 0; i < block.outEdges.size(); i++) {
+            const SchemeModel::Edge& edge = model->edgeAt(block.outEdges[i]);
+            appendInt(&buffer, block.id);
+            appendInt(&buffer, model->blockAt(edge.to).id);
+            appendInt(&buffer, edge.toPort);
+        }
+        if (progress && (slot & 4095) == 0)
+            progress->storeRelease(50 + int(qint64(slot) * 50 / model->slotCount()));
+    }
+    buffer.append(tiles);
+    buffer.append(values);
+
+    if (file.write(buffer) != buffer.size()) {
+        *error = file.errorString();
+        return false;
+    }
+    file.close();
+    return true;
+}
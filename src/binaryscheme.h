@@ -0,0 +1,90 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Binary format of a scheme file.
+ * @file binaryscheme.h
+ *
+ *
+ */
+
+#ifndef BINARYSCHEME_H
+#define BINARYSCHEME_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <QtGlobal>
+#include "schememodel.h"
+
+class Scene;
+
+/**
+ * @brief The BinaryScheme class reads and writes schemes in a compact binary format.
+ *
+ * The file starts with a header of 32 bytes: the magic "BESCHEME", the version, the number
+ * of blocks, the number of connections, the size of a tile and the number of tiles (all little-endian
+ * 32-bit integers), the rest is reserved. Then follow the blocks as records of four 32-bit integers
+ * (type, id, x, y) and the connections as records of three 32-bit integers (id of the source block,
+ * id of the target block, input port). Connections of one source block are stored in the order they
+ * were created.
+ *
+ * Version 2 adds a spatial index. The scene is divided into square tiles and the blocks are stored
+ * tile by tile. After the connections follow the tiles as records of four 32-bit integers (column,
+ * row, index of the first block of the tile, number of its blocks). The model gets the whole scheme,
+ * but the scene creates items only for the tiles in view. Version 1 files have no tiles.
+ *
+ * Version 3 stores the values of Input blocks. The header gets the number of values after the number
+ * of tiles and the values follow the tiles as records of the block id (32-bit integer) and the value
+ * (little-endian IEEE double).
+ *
+ * The file is memory-mapped for reading, the records are read in place.
+ */
+class BinaryScheme
+{
+public:
+    /**
+     * @brief Magic bytes at the beginning of every binary scheme file.
+     */
+    static const char Magic[8];
+    /**
+     * @brief Version of the format written by write().
+     */
+    static const quint32 Version = 3;
+    /**
+     * @brief Size of the tiles of the spatial index written by write().
+     */
+    static const int TileSize = 1024;
+    /**
+     * @brief Suffix of binary scheme files offered by the save dialog.
+     */
+    static const char* Suffix;
+    /**
+     * @brief isBinaryFile checks the magic header of a file.
+     * @param fileName Full path to the file.
+     * @return true if the file is a binary scheme.
+     */
+    static bool isBinaryFile(const QString &fileName);
+    /**
+     * @brief read loads a binary scheme file into an empty scene using its bulk construction path.
+     * @param fileName Full path to the file.
+     * @param scene Scene to load the scheme into, the caller surrounds the call with beginLoad() and endLoad().
+     * @param error Description of the problem if the file cannot be read.
+     * @param warning If given, filled with the description of left out connections, empty if there are none.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    static bool read(const QString &fileName, Scene* scene, QString* error, QString* warning = NULL);
+    /**
+     * @brief write saves a scheme to a binary file.
+     * @param model Model of the scheme.
+     * @param fileName Full path to the file.
+     * @param error Description of the problem if the file cannot be written.
+     * @param progress If given, receives the percentage of the blocks written so far.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    static bool write(const SchemeModel* model, const QString &fileName, QString* error, QAtomicInt* progress = NULL);
+};
+
+#endif // BINARYSCHEME_H
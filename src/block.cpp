@@ -14,27 +14,30 @@
 #include "block.h"
 #include "scene.h"
 
+#include <QStyleOptionGraphicsItem>
+
 int Block::idCounter = 0;
 
+/** Below this scale, a block is drawn as a flat rectangle without the outline and title. */
+static const qreal LowDetail = 0.5;
+
 Block::Block(blockType type, Scene* scene, QPoint position, int newId){
     bType = type;
     this->parentScene = scene;
 
     if (newId >= 0) {
         id = newId;
-        idCounter = qMax(idCounter+1, id);
+        reserveId(id);
     }
     else {
         id = idCounter++;
     }
 
     setPos(position);
-    dataSet = false;
-    setFlag(ItemSendsScenePositionChanges);
+    // The scene lets the block be moved and selected only in its select mode
+    setFlags(ItemIsMovable | ItemIsSelectable | ItemSendsGeometryChanges);
     setAcceptHoverEvents(true);
 
-    QGraphicsProxyWidget* pMyProxy;
-    QRectF rect;
     switch (bType) {
     case Add:
         createPorts(2, Port::InPort);
@@ -74,32 +77,10 @@ Block::Block(blockType type, Scene* scene, QPoint position, int newId){
     case Input:
         createPorts(1, Port::OutPort);
         title = "Input";
-        textBox = new QLineEdit();
-        textBox->setPlaceholderText("input");
-        textBox->setValidator(new QDoubleValidator(-1.79769e+308, 1.79769e+308, 50, this));
-        pMyProxy = new QGraphicsProxyWidget(this);
-        rect = boundingRect();
-        rect.setX(rect.x() + 20);
-        rect.setY(rect.y() + 20);
-        rect.setWidth(rect.width() - 20);
-        rect.setHeight(20);
-        pMyProxy->setWidget(textBox);
-        pMyProxy->setGeometry(rect);
-        QObject::connect(textBox, SIGNAL(textChanged(QString)), this, SLOT(inputChanged(QString)));
         break;
     case Output:
         createPorts(1, Port::InPort);
         title = "Output";
-        textBox = new QLineEdit();
-        textBox->setReadOnly(true);
-        pMyProxy = new QGraphicsProxyWidget(this);
-        rect = boundingRect();
-        rect.setX(rect.x() + 20);
-        rect.setY(rect.y() + 20);
-        rect.setWidth(rect.width() - 20);
-        rect.setHeight(20);
-        pMyProxy->setWidget(textBox);
-        pMyProxy->setGeometry(rect);
         break;
     }
 }
@@ -138,13 +119,31 @@ QRectF Block::boundingRect() const {
     return QRectF(0, 0, 120, 50);
 }
 
+QRectF Block::valueFieldRect() const {
+    QRectF rect = boundingRect();
+    return QRectF(rect.x() + 20, rect.y() + 20, rect.width() - 20, 20);
+}
+
+bool Block::hasValueField() const {
+    return bType == Input || bType == Output;
+}
+
+QString Block::valueText() const {
+    return fieldText;
+}
+
 void Block::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent){
     Q_UNUSED(parent);
-    Q_UNUSED(option);
 
     // Get block rectangle size
     QRectF rectangle = boundingRect();
 
+    // Too small to read, only the color tells anything
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < LowDetail) {
+        painter->fillRect(rectangle, parentScene->getLastCalculated() == this ? Qt::darkBlue : Qt::gray);
+        return;
+    }
+
     // Draw the rectangle
     if (parentScene->getLastCalculated() == this) {
         QPen pen(Qt::darkBlue);
@@ -156,26 +155,32 @@ void Block::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWi
     painter->fillRect(rectangle, brush);
     painter->drawRect(rectangle);
     painter->drawText(rectangle, Qt::AlignHCenter, title);
-}
 
-QVariant Block::itemChange(GraphicsItemChange change, const QVariant &value){
-    if (change == ItemPositionChange && scene()) {
-        QPointF newPos = value.toPointF();
-        qDebug() << "blockChange:" << newPos;
-        movePortsWithBlock(newPos);
+    // The value field is only painted, the scene opens its editor over it when an input is edited
+    if (hasValueField()) {
+        QRectF field = valueFieldRect();
+        painter->setPen(Qt::darkGray);
+        painter->fillRect(field, Qt::white);
+        painter->drawRect(field);
+        field.adjust(3, 0, -3, 0);
+        if (fieldText.isEmpty() && bType == Input) {
+            painter->drawText(field, Qt::AlignLeft | Qt::AlignVCenter, "input");
+        }
+        else {
+            painter->setPen(Qt::black);
+            painter->drawText(field, Qt::AlignLeft | Qt::AlignVCenter,
+                              painter->fontMetrics().elidedText(fieldText, Qt::ElideRight, int(field.width())));
+        }
     }
-    return QGraphicsItem::itemChange(change, value);
 }
 
-void Block::movePortsWithBlock(QPointF newPos) {
-    QPointF position;
-    int x, y;
-    foreach (Port* port, getPortList()) {
-        x = port->getRelPos().x() + newPos.x();
-        y = port->getRelPos().y() + newPos.y();
-        position = QPointF(x, y);
-        port->setPos(position);
+QVariant Block::itemChange(GraphicsItemChange change, const QVariant &value){
+    if (change == ItemPositionHasChanged && scene()) {
+        // The ports are child items and move along, the scene moves the lines once for all moved blocks
+        parentScene->schemeModel()->moveBlock(id, qRound(pos().x()), qRound(pos().y()));
+        parentScene->blockMoved(this);
     }
+    return QGraphicsItem::itemChange(change, value);
 }
 
 void Block::createPorts(int numberOfPorts, Port::portType type)
@@ -193,41 +198,12 @@ void Block::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 {
     Q_UNUSED(event)
 
-    if (dataSet)
-        setToolTip(QString::number(blockData));
+    if (areDataSet())
+        setToolTip(QString::number(getData()));
     else
         setToolTip("No value");
 }
 
-void Block::writeToStream(QTextStream* stream)
-{
-    *stream << QString::number(int(bType)) << " ";
-    *stream << QString::number(id) << " ";
-    *stream << QString::number(pos().x()) << " ";
-    *stream << QString::number(pos().y()) << " ";
-    *stream << QString::number(getNextBlocks().size()) << " ";
-    int id_previous = -1;
-    foreach (Block* next, getNextBlocks()) {
-        *stream << QString::number(next->idBlock()) << " ";
-        if (id_previous == next->idBlock())
-            *stream << QString::number(next->getInPortConnectedToBlock(this)->numberOfPortRec()+1) << " ";
-        else
-            *stream << QString::number(next->getInPortConnectedToBlock(this)->numberOfPortRec()) << " ";
-        id_previous = next->idBlock();
-    }
-    *stream << "\n";
-}
-
-Port *Block::getInPortConnectedToBlock(Block *block)
-{
-    Port* outPort = block->getOutPort();
-    foreach (Port* port, inPortList) {
-        if (port->existsConnection(outPort))
-            return port;
-    }
-    return NULL;
-}
-
 QList<Port*> Block::getPortList()
 {
     QList<Port*> list;
@@ -266,175 +242,94 @@ bool Block::allInputPortsConnected()
     return true;
 }
 
-bool Block::allInputsSet()
-{
-    foreach (Port* port, inPortList) {
-        if (!port->areDataSet())
-            return false;
-    }
-    return true;
-}
-
 void Block::removePort(Port *port)
 {
     inPortList.removeOne(port) || outPortList.removeOne(port);
-    parentScene->removeItem(port);
+    // Deleting a child item removes it from the block and the scene
     delete port;
 }
 
-void Block::doCalculation(Block::calcError* err)
+double Block::getData()
 {
-    if (!allInputPortsConnected())
-        return;
+    return parentScene->schemeModel()->value(id);
+}
 
-    double input1;
-    double input2;
-    switch (bType) {
-    case Add:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        input2 = inPortList.at(1)->getData();
-        // Calculate new value
-        setData(input1 + input2);
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Sub:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        input2 = inPortList.at(1)->getData();
-        // Calculate new value
-        setData(input1 - input2);
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Mul:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        input2 = inPortList.at(1)->getData();
-        // Calculate new value
-        setData(input1 * input2);
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Div:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        input2 = inPortList.at(1)->getData();
-        // Calculate new value
-        if (input2 == 0) {
-            if (err)
-                *err = DivByZero;
-            return;
-        }
-        setData(input1 / input2);
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Pow2:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        // Calculate new value
-        setData(input1*input1);
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case PowX:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        input2 = inPortList.at(1)->getData();
-        // Calculate new value
-        setData(qPow(input1, input2));
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Sqrt:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        // Calculate new value
-        setData(qSqrt(input1));
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Input:
-        // Delegate
-        foreach (Port* nextPort, outPortList.first()->getNextPorts()) {
-            nextPort->setData(this->blockData);
-        }
-        break;
-    case Output:
-        // Get inputs
-        input1 = inPortList.at(0)->getData();
-        // Calculate new value
-        setData(input1);
-        // Delegate
-        textBox->setText(QString::number(blockData));
-        break;
-    }
-    qDebug() << "Calculating block:" << id;
+bool Block::areDataSet()
+{
+    return parentScene->schemeModel()->hasValue(id);
 }
 
-double Block::getData()
+bool Block::isInputConnected(int position)
 {
-    return blockData;
+    return parentScene->schemeModel()->isInputConnected(id, position);
 }
 
-void Block::setData(double data)
+double Block::getInputData(int position)
 {
-    qDebug() << "block setData:" << data;
-    blockData = data;
-    dataSet = true;
+    return parentScene->schemeModel()->inputValue(id, position);
 }
 
-bool Block::areDataSet()
+bool Block::areInputDataSet(int position)
 {
-    return dataSet;
+    return parentScene->schemeModel()->inputHasValue(id, position);
 }
 
-void Block::unsetData()
+void Block::recycle(int newId, QPoint position)
 {
-    dataSet = false;
+    id = newId;
+    reserveId(id);
+    // Not in a scene, so the model is not told about the move
+    setPos(position);
+    foreach (Port* port, getPortList())
+        port->unselectPort();
+    fieldText.clear();
 }
 
-void Block::clearOutputField()
+void Block::reserveId(int usedId)
+{
+    idCounter = qMax(idCounter, usedId + 1);
+}
+
+void Block::updateInputField()
+{
+    if (bType != Input || !areDataSet()) return;
+    // The value comes from the model, it must not be set there again
+    setFieldText(QString::number(getData(), 'g', QLocale::FloatingPointShortest));
+}
+
+void Block::updateOutputField()
 {
     if (bType != Output) return;
-    textBox->setText(QString(""));
+    if (areDataSet())
+        setFieldText(QString::number(getData()));
+    else
+        setFieldText(QString(""));
 }
 
-void Block::inputChanged(const QString &text)
+void Block::setInputValue(double value)
 {
-    setData(QLocale().toDouble(text));
-    qDebug() << "Value updated:" << getData();
+    if (bType != Input) return;
+    // Shortest text that reads back as the same double
+    setInputText(QString::number(value, 'g', QLocale::FloatingPointShortest));
 }
 
-bool Block::containsLoops(Block *checkedBlock)
+void Block::clearOutputField()
 {
-    if (checkedBlock == this) return true;
-
-    foreach (Port* outPort, outPortList) {
-        if (!outPort->isConnected())
-            continue;
-        foreach (Block* nextBlock, outPort->getNextBlocks()) {
-            if (nextBlock->containsLoops(checkedBlock))
-                return true;
-        }
-    }
-    return false;
+    if (bType != Output) return;
+    setFieldText(QString(""));
 }
 
+void Block::setFieldText(const QString &text)
+{
+    if (fieldText == text) return;
+    fieldText = text;
+    parentScene->markDirty(this);
+}
 
+void Block::setInputText(const QString &text)
+{
+    if (bType != Input || fieldText == text) return;
+    setFieldText(text);
+    parentScene->schemeModel()->setInputValue(id, QLocale().toDouble(text));
+    parentScene->inputValueChanged(this);
+}
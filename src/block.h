@@ -17,12 +17,8 @@
 #include <QGraphicsScene>
 #include <QGraphicsItem>
 #include <QPainter>
-#include <QGraphicsProxyWidget>
-#include <QLineEdit>
-#include <QDoubleValidator>
 #include <QDebug>
 #include <QtMath>
-#include <QTextStream>
 #include "port.h"
 
 class Scene;
@@ -73,7 +69,7 @@ public:
      */
     QRectF boundingRect() const;
     /**
-     * @brief itemChange determines the position of the block and calls the function to move ports of this block.
+     * @brief itemChange passes the new position of the block to the model and lets the scene move its lines.
      * @param change controls block state.
      * @param value is a new position of a block.
      * @return this function.
@@ -82,7 +78,7 @@ public:
     /**
      * @brief paint draws blocks.
      * @param painter is a pointer to QPainter.
-     * @param option is a pointer to style's options. Doesn't use.
+     * @param option is a pointer to style's options, its level of detail decides what is drawn.
      * @param parent is a pointer to the parent. Doesn't use.
      */
     void paint(QPainter *painter,const QStyleOptionGraphicsItem *option, QWidget *parent);
@@ -101,50 +97,87 @@ public:
      * @return bool value. True is if all ports are connected, otherwise False is returned.
      */
     bool allInputPortsConnected();
-    /**
-     * @brief allInputsSet checks if all Input ports have a value.
-     * @return bool value. True is if all Input ports have a value, otherwise is False.
-     */
-    bool allInputsSet();
-    /**
-     * @brief containsLoops checks if the scheme doesn't contain cycles. Recursively checks all blocks.
-     * @param block is the block for what it is checking.
-     * @return bool value. True is if it contains a loop, False is if it doesn't.
-     */
-    bool containsLoops(Block* block);
     /**
      * @brief removePort deletes a port.
      * @param port is the port, what must be deleted.
      */
     void removePort(Port* port);
-    /**
-     * @brief doCalculation does calculating of the scheme's values.
-     * @param err is information about errors.
-     */
-    void doCalculation(calcError* err = NULL);
     /**
      * @brief getData returns a value of a block.
      * @return data of a block.
      */
     double getData();
-    /**
-     * @brief setData writes data of a block.
-     * @param data is a value what should be written.
-     */
-    void setData(double data);
     /**
      * @brief areDataSet checks if a block has data.
      * @return bool value. True if block has data, otherwise it is False.
      */
     bool areDataSet();
     /**
-     * @brief unsetData set the block's data to False.
+     * @brief isInputConnected checks if an input port of the block is connected in the model, also to a block without an item.
+     * @param position Position of the input port.
+     * @return bool value. True if the port is connected, otherwise it is False.
+     */
+    bool isInputConnected(int position);
+    /**
+     * @brief getInputData returns a value received by an input port of the block.
+     * @param position Position of the input port.
+     * @return data of the port.
      */
-    void unsetData();
+    double getInputData(int position);
+    /**
+     * @brief areInputDataSet checks if an input port of the block has received a value.
+     * @param position Position of the input port.
+     * @return bool value. True if the port has data, otherwise it is False.
+     */
+    bool areInputDataSet(int position);
+    /**
+     * @brief updateOutputField shows the calculated value in the field of an output block.
+     */
+    void updateOutputField();
+    /**
+     * @brief setInputValue writes a value into the field of an input block, which passes it to the model.
+     * @param value New value.
+     */
+    void setInputValue(double value);
     /**
      * @brief clearOutputField clear the field of output port.
      */
     void clearOutputField();
+    /**
+     * @brief setInputText sets the text of the field of an input block and passes its value to the model.
+     * @param text New text of the field.
+     */
+    void setInputText(const QString &text);
+    /**
+     * @brief valueText returns the text of the value field.
+     * @return text of the field, empty if the block has none.
+     */
+    QString valueText() const;
+    /**
+     * @brief hasValueField checks if the block shows a value, which Input and Output blocks do.
+     * @return bool value. True if the block has a value field, otherwise it is False.
+     */
+    bool hasValueField() const;
+    /**
+     * @brief valueFieldRect returns where the value field is painted.
+     * @return rectangle of the field in the block's coordinates.
+     */
+    QRectF valueFieldRect() const;
+    /**
+     * @brief recycle gives a block that is not in a scene the identity of another block of the same type.
+     * @param newId Id of the block.
+     * @param position Position of the block.
+     */
+    void recycle(int newId, QPoint position);
+    /**
+     * @brief updateInputField shows the value of an input block in its field without changing the model.
+     */
+    void updateInputField();
+    /**
+     * @brief reserveId makes sure new blocks never get a given id, e.g. of a block which exists only in the model.
+     * @param usedId Id already used by a block.
+     */
+    static void reserveId(int usedId);
     /**
      * @brief idBlock returns the id of a block.
      * @return id of a block.
@@ -160,23 +193,6 @@ public:
      * @return list of input ports.
      */
     QList<Port*> getInPortList();
-    /**
-     * @brief writeToStream Writes block parameters to a stream.
-     * @param stream Stream to write the parameters to.
-     */
-    void writeToStream(QTextStream* stream);
-    /**
-     * @brief getInPortConnectedToBlock Returns a port which is connected to the given block.
-     * @param block Block, about which we want to know, to what port it is connected.
-     * @return Returns a pointer to a port, if it is found, or nullPtr otherwise.
-     */
-    Port* getInPortConnectedToBlock(Block* block);
-private slots:
-    /**
-     * @brief inputChanged insert changed text of a input block.
-     * @param text is a changed text.
-     */
-    void inputChanged(const QString &text);
 private:
     Scene* parentScene; /**< pointer to the Scene, where we make a scheme.*/
     static int idCounter; /**< id of a block.*/
@@ -185,21 +201,19 @@ private:
     QList<Port*> inPortList; /**< List of input ports*/
     QList<Port*> outPortList; /**< List of output ports*/
     const char* title; /**< type of a block, what is written on the block.*/
-    double blockData; /**< value of a block.*/
-    bool dataSet; /**< variable what checks if block has data*/
-    QLineEdit* textBox; /**< place where is written a block's value */
+    QString fieldText; /**< text of the value field, painted by paint() */
 
-    /**
-     * @brief movePortsWithBlock moves block's ports with the block.
-     * @param newPos is new position of a block.
-     */
-    void movePortsWithBlock(QPointF newPos);
     /**
      * @brief createPorts creates ports, when was created a block.
      * @param numberOfPorts is a number of port. 1 is if it is output port. 2 or 1 is if it is a input port.
      * @param type is a type of a port.
      */
     void createPorts(int numberOfPorts, Port::portType type);
+    /**
+     * @brief setFieldText changes the text of the value field and schedules the block's redraw.
+     * @param text New text of the field.
+     */
+    void setFieldText(const QString &text);
     void hoverMoveEvent(QGraphicsSceneHoverEvent* event);
 };
 
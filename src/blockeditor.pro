@@ -1,7 +1,7 @@
 TEMPLATE = app
 TARGET = blockeditor
 
-QT += core gui
+QT += core gui concurrent
 CONFIG += c++14
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
@@ -13,7 +13,14 @@ SOURCES += \
     block.cpp \
     blockconnection.cpp \
     port.cpp \
-    line.cpp
+    line.cpp \
+    binaryscheme.cpp \
+    schemereader.cpp \
+    schemewriter.cpp \
+    schemesaver.cpp \
+    schemejournal.cpp \
+    compresseddevice.cpp \
+    edgelayer.cpp
 
 HEADERS  += \
     mainwindow.h \
@@ -21,7 +28,16 @@ HEADERS  += \
     block.h \
     blockconnection.h \
     port.h \
-    line.h
+    line.h \
+    binaryscheme.h \
+    schemereader.h \
+    schemewriter.h \
+    schemesaver.h \
+    schemejournal.h \
+    compresseddevice.h \
+    edgelayer.h
+
+include(model/model.pri)
 
 RESOURCES += \
     blockeditor.qrc
@@ -0,0 +1,182 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the compressed device.
+ * @file compresseddevice.cpp
+ *
+ *
+ */
+
+#include "compresseddevice.h"
+
+#include <QtEndian>
+#include <cstring>
+
+const char CompressedDevice::Magic[8] = { 'B', 'E', 'S', 'C', 'H', 'Z', 'I', 'P' };
+const char* CompressedDevice::Suffix = "schz";
+
+CompressedDevice::CompressedDevice(QIODevice* device)
+{
+    this->device = device;
+    chunkPosition = 0;
+    ended = false;
+    failed = false;
+}
+
+CompressedDevice::~CompressedDevice()
+{
+    close();
+}
+
+bool CompressedDevice::isCompressed(QIODevice* device)
+{
+    QByteArray magic = device->peek(sizeof(Magic));
+    return magic.size() == int(sizeof(Magic)) && memcmp(magic.constData(), Magic, sizeof(Magic)) == 0;
+}
+
+bool CompressedDevice::open(OpenMode mode)
+{
+    chunk.clear();
+    chunkPosition = 0;
+    ended = false;
+    failed = false;
+
+    if (mode & ReadOnly) {
+        if (device->read(sizeof(Magic)) != QByteArray(Magic, sizeof(Magic))) {
+            setErrorString("The file is not compressed.");
+            return false;
+        }
+    }
+    else if (device->write(Magic, sizeof(Magic)) != qint64(sizeof(Magic))) {
+        setErrorString(device->errorString());
+        return false;
+    }
+    return QIODevice::open(mode);
+}
+
+bool CompressedDevice::finish()
+{
+    if (ended || !(openMode() & WriteOnly))
+        return !failed;
+    ended = true;
+    // The rest of the data, then an empty chunk marking the end
+    writeChunk();
+    uchar end[4] = { 0, 0, 0, 0 };
+    if (!failed && device->write((const char*)end, 4) != 4) {
+        setErrorString(device->errorString());
+        failed = true;
+    }
+    return !failed;
+}
+
+void CompressedDevice::close()
+{
+    if (!isOpen())
+        return;
+    finish();
+    QIODevice::close();
+}
+
+bool CompressedDevice::isSequential() const
+{
+    return true;
+}
+
+bool CompressedDevice::atEnd() const
+{
+    return ended && chunkPosition == chunk.size() && QIODevice::atEnd();
+}
+
+bool CompressedDevice::readChunk()
+{
+    uchar length[4];
+    if (device->read((char*)length, 4) != 4) {
+        setErrorString("The compressed data are truncated.");
+        return false;
+    }
+    quint32 size = qFromLittleEndian<quint32>(length);
+    if (size == 0) {
+        ended = true;
+        chunk.clear();
+        chunkPosition = 0;
+        return true;
+    }
+
+    // qCompress() never makes a chunk much larger, anything bigger is not worth reading into memory
+    if (size < 4 || size > quint32(MaxCompressedSize)) {
+        setErrorString("The compressed data are corrupted.");
+        return false;
+    }
+    QByteArray compressed = device->read(size);
+    if (compressed.size() != int(size)) {
+        setErrorString("The compressed data are truncated.");
+        return false;
+    }
+    // qUncompress() allocates the size from the big-endian header of the chunk, no chunk is written larger than ChunkSize
+    quint32 uncompressedSize = qFromBigEndian<quint32>((const uchar*)compressed.constData());
+    if (uncompressedSize == 0 || uncompressedSize > quint32(ChunkSize)) {
+        setErrorString("The compressed data are corrupted.");
+        return false;
+    }
+    chunk = qUncompress(compressed);
+    chunkPosition = 0;
+    if (chunk.isEmpty()) {
+        setErrorString("The compressed data are corrupted.");
+        return false;
+    }
+    return true;
+}
+
+qint64 CompressedDevice::readData(char* data, qint64 maxSize)
+{
+    qint64 count = 0;
+    while (count < maxSize) {
+        if (chunkPosition == chunk.size()) {
+            if (ended)
+                break;
+            if (!readChunk())
+                return -1;
+            continue;
+        }
+        qint64 part = qMin(maxSize - count, qint64(chunk.size() - chunkPosition));
+        memcpy(data + count, chunk.constData() + chunkPosition, part);
+        chunkPosition += int(part);
+        count += part;
+    }
+    return count;
+}
+
+bool CompressedDevice::writeChunk()
+{
+    if (chunk.isEmpty() || failed)
+        return !failed;
+    QByteArray compressed = qCompress(chunk);
+    chunk.clear();
+
+    uchar length[4];
+    qToLittleEndian<quint32>(compressed.size(), length);
+    if (device->write((const char*)length, 4) != 4 || device->write(compressed) != compressed.size()) {
+        setErrorString(device->errorString());
+        failed = true;
+    }
+    return !failed;
+}
+
+qint64 CompressedDevice::writeData(const char* data, qint64 size)
+{
+    if (ended)
+        return -1;
+    qint64 written = 0;
+    while (written < size) {
+        qint64 part = qMin(size - written, qint64(ChunkSize - chunk.size()));
+        chunk.append(data + written, int(part));
+        written += part;
+        if (chunk.size() == ChunkSize && !writeChunk())
+            return -1;
+    }
+    return written;
+}
@@ -0,0 +1,97 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Device compressing the data of another device in chunks.
+ * @file compresseddevice.h
+ *
+ *
+ */
+
+#ifndef COMPRESSEDDEVICE_H
+#define COMPRESSEDDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+/**
+ * @brief The CompressedDevice class is a sequential device which compresses everything written to it
+ * into another device, or decompresses everything read from it out of another device.
+ *
+ * The data start with the magic "BESCHZIP". Then follow chunks, each is the length of the compressed
+ * chunk (little-endian 32-bit integer) and the chunk compressed by qCompress(), which starts with the
+ * uncompressed length (big-endian 32-bit integer). A chunk of length 0 ends the data. Every chunk holds
+ * at most ChunkSize bytes, so the reader never keeps more than one chunk in memory and the data can be
+ * parsed while they are being decompressed. A chunk claiming more is rejected before it is decompressed.
+ */
+class CompressedDevice : public QIODevice
+{
+public:
+    /**
+     * @brief Magic bytes at the beginning of every compressed file.
+     */
+    static const char Magic[8];
+    /**
+     * @brief Suffix of compressed scheme files offered by the save dialog.
+     */
+    static const char* Suffix;
+    /**
+     * @brief ChunkSize is the largest number of bytes compressed at once.
+     */
+    enum { ChunkSize = 256 * 1024 };
+    /**
+     * @brief MaxCompressedSize is the largest length of a compressed chunk, a bit more than zlib needs for ChunkSize bytes.
+     */
+    enum { MaxCompressedSize = ChunkSize + ChunkSize / 64 + 64 };
+
+    /**
+     * @brief CompressedDevice is the constructor.
+     * @param device Open device with the compressed data.
+     */
+    CompressedDevice(QIODevice* device);
+    /**
+     * @brief ~CompressedDevice closes the device.
+     */
+    ~CompressedDevice();
+    /**
+     * @brief isCompressed checks the magic at the current position of a device without reading it.
+     * @param device Open device.
+     * @return true if the device contains compressed data.
+     */
+    static bool isCompressed(QIODevice* device);
+
+    /**
+     * @brief open opens the device, reading or writing the magic.
+     * @param mode ReadOnly or WriteOnly.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    bool open(OpenMode mode);
+    /**
+     * @brief finish writes the rest of the data and the end of the chunks, nothing can be written afterwards.
+     * @return Returns true if all data were written to the underlying device, false otherwise.
+     */
+    bool finish();
+    /**
+     * @brief close finishes the data when writing and closes the device.
+     */
+    void close();
+    bool isSequential() const;
+    bool atEnd() const;
+protected:
+    qint64 readData(char* data, qint64 maxSize);
+    qint64 writeData(const char* data, qint64 size);
+private:
+    QIODevice* device; /**< device with the compressed data.*/
+    QByteArray chunk; /**< uncompressed chunk being read or written.*/
+    int chunkPosition; /**< next byte of the chunk to read.*/
+    bool ended; /**< whether the last chunk was read.*/
+    bool failed; /**< whether writing to the device failed.*/
+
+    bool readChunk();
+    bool writeChunk();
+};
+
+#endif // COMPRESSEDDEVICE_H
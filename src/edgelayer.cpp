@@ -0,0 +1,300 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of class EdgeLayer.
+ * @file edgelayer.cpp
+ */
+
+#include "edgelayer.h"
+#include "scene.h"
+
+#include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+/** Below this scale, lines are drawn as thin lines without antialiasing, as Line does. */
+static const qreal LowDetail = 0.5;
+/** Largest distance of a click from a line which still hits it. */
+static const qreal Tolerance = 4;
+
+static qint64 cellKey(int column, int row)
+{
+    return qint64(row) * (Q_INT64_C(1) << 32) + column;
+}
+
+static QRectF lineRect(const QLineF &segment)
+{
+    // The width of the pen is outside of the line itself
+    return QRectF(segment.p1(), segment.p2()).normalized().adjusted(-2, -2, 2, 2);
+}
+
+static qreal distance(const QLineF &segment, const QPointF &point)
+{
+    QPointF direction = segment.p2() - segment.p1();
+    qreal length = QPointF::dotProduct(direction, direction);
+    qreal t = 0;
+    if (length > 0)
+        t = qBound(qreal(0), QPointF::dotProduct(point - segment.p1(), direction) / length, qreal(1));
+    QPointF nearest = segment.p1() + t * direction;
+    return QLineF(nearest, point).length();
+}
+
+EdgeLayer::EdgeLayer(Scene* scene)
+{
+    parentScene = scene;
+    paintEpoch = 0;
+    selectedCount = 0;
+    setZValue(-1);
+    setAcceptHoverEvents(true);
+    setFlag(ItemUsesExtendedStyleOption);
+}
+
+int EdgeLayer::type() const
+{
+    return Type;
+}
+
+QList<qint64> EdgeLayer::cellsOf(const QLineF &segment) const
+{
+    // Points at most half a cell apart, any point near the line is in a neighbouring cell of one of them
+    int steps = qCeil(segment.length() / (CellSize / 2));
+    QList<qint64> cells;
+    for (int i = 0; i <= steps; i++) {
+        QPointF point = steps ? segment.pointAt(qreal(i) / steps) : segment.p1();
+        qint64 key = cellKey(qFloor(point.x() / CellSize), qFloor(point.y() / CellSize));
+        if (cells.isEmpty() || cells.last() != key)
+            cells.append(key);
+    }
+    return cells;
+}
+
+void EdgeLayer::insertIntoGrid(int index)
+{
+    foreach (qint64 key, cellsOf(segments[index]))
+        grid[key].append(index);
+}
+
+void EdgeLayer::removeFromGrid(int index)
+{
+    foreach (qint64 key, cellsOf(segments[index])) {
+        QHash<qint64, QVector<int> >::iterator cell = grid.find(key);
+        if (cell == grid.end())
+            continue;
+        cell->removeOne(index);
+        if (cell->isEmpty())
+            grid.erase(cell);
+    }
+}
+
+void EdgeLayer::addEdge(Line* line)
+{
+    int index = segments.size();
+    segments.append(line->line());
+    owners.append(line);
+    selected.append(false);
+    paintMark.append(0);
+    indexOf.insert(line, index);
+    insertIntoGrid(index);
+
+    QRectF rect = lineRect(segments[index]);
+    if (!bounds.contains(rect)) {
+        prepareGeometryChange();
+        bounds |= rect;
+    }
+    update(rect);
+}
+
+void EdgeLayer::removeEdge(Line* line)
+{
+    int index = indexOf.value(line, -1);
+    if (index < 0)
+        return;
+    update(lineRect(segments[index]));
+    removeFromGrid(index);
+    indexOf.remove(line);
+    if (selected[index])
+        selectedCount--;
+
+    // The last line takes the free place, so the arrays stay without holes
+    int last = segments.size() - 1;
+    if (index != last) {
+        removeFromGrid(last);
+        segments[index] = segments[last];
+        owners[index] = owners[last];
+        selected[index] = selected[last];
+        indexOf[owners[index]] = index;
+        insertIntoGrid(index);
+    }
+    segments.removeLast();
+    owners.removeLast();
+    selected.removeLast();
+    paintMark.removeLast();
+
+    if (segments.isEmpty()) {
+        prepareGeometryChange();
+        bounds = QRectF();
+    }
+}
+
+void EdgeLayer::updateEdge(Line* line)
+{
+    int index = indexOf.value(line, -1);
+    if (index < 0)
+        return;
+    update(lineRect(segments[index]));
+    removeFromGrid(index);
+    segments[index] = line->line();
+    insertIntoGrid(index);
+
+    QRectF rect = lineRect(segments[index]);
+    if (!bounds.contains(rect)) {
+        prepareGeometryChange();
+        bounds |= rect;
+    }
+    update(rect);
+}
+
+Line* EdgeLayer::edgeAt(const QPointF &position) const
+{
+    int column = qFloor(position.x() / CellSize);
+    int row = qFloor(position.y() / CellSize);
+    Line* nearest = NULL;
+    qreal nearestDistance = Tolerance;
+    for (int y = row - 1; y <= row + 1; y++) {
+        for (int x = column - 1; x <= column + 1; x++) {
+            QHash<qint64, QVector<int> >::const_iterator cell = grid.constFind(cellKey(x, y));
+            if (cell == grid.constEnd())
+                continue;
+            foreach (int index, *cell) {
+                qreal d = distance(segments[index], position);
+                if (d <= nearestDistance) {
+                    nearestDistance = d;
+                    nearest = owners[index];
+                }
+            }
+        }
+    }
+    return nearest;
+}
+
+QList<Line*> EdgeLayer::edges() const
+{
+    return owners.toList();
+}
+
+QList<Line*> EdgeLayer::selectedEdges() const
+{
+    QList<Line*> list;
+    for (int i = 0; i < selected.size(); i++) {
+        if (selected[i])
+            list.append(owners[i]);
+    }
+    return list;
+}
+
+void EdgeLayer::setSelected(int index, bool isSelected)
+{
+    if (selected[index] == isSelected)
+        return;
+    selected[index] = isSelected;
+    selectedCount += isSelected ? 1 : -1;
+    update(lineRect(segments[index]));
+}
+
+void EdgeLayer::clearSelection()
+{
+    // Called on every click and mode switch, so it does nothing without a selection
+    if (selectedCount == 0)
+        return;
+    for (int i = 0; i < selected.size(); i++)
+        setSelected(i, false);
+}
+
+QRectF EdgeLayer::boundingRect() const
+{
+    return bounds;
+}
+
+bool EdgeLayer::contains(const QPointF &point) const
+{
+    return edgeAt(point) != NULL;
+}
+
+void EdgeLayer::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent)
+{
+    Q_UNUSED(parent);
+
+    // Lines of the exposed cells, or all of them when there are fewer lines than cells
+    QRectF exposed = option->exposedRect;
+    int left = qFloor(exposed.left() / CellSize) - 1;
+    int right = qFloor(exposed.right() / CellSize) + 1;
+    int top = qFloor(exposed.top() / CellSize) - 1;
+    int bottom = qFloor(exposed.bottom() / CellSize) + 1;
+
+    QVector<QLineF> normal;
+    QVector<QLineF> highlighted;
+    if (qint64(right - left + 1) * (bottom - top + 1) > segments.size()) {
+        for (int i = 0; i < segments.size(); i++)
+            (selected[i] ? highlighted : normal).append(segments[i]);
+    }
+    else {
+        if (++paintEpoch == 0) {
+            paintMark.fill(0);
+            paintEpoch = 1;
+        }
+        for (int row = top; row <= bottom; row++) {
+            for (int column = left; column <= right; column++) {
+                QHash<qint64, QVector<int> >::const_iterator cell = grid.constFind(cellKey(column, row));
+                if (cell == grid.constEnd())
+                    continue;
+                foreach (int index, *cell) {
+                    if (paintMark[index] == paintEpoch)
+                        continue;
+                    paintMark[index] = paintEpoch;
+                    (selected[index] ? highlighted : normal).append(segments[index]);
+                }
+            }
+        }
+    }
+
+    qreal width = 3;
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < LowDetail) {
+        // A cosmetic pen is the fastest to stroke, the view restores the hints for the next item
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        width = 0;
+    }
+    painter->setPen(QPen(Qt::black, width));
+    painter->drawLines(normal);
+    painter->setPen(QPen(Qt::darkBlue, width));
+    painter->drawLines(highlighted);
+}
+
+void EdgeLayer::mousePressEvent(QGraphicsSceneMouseEvent *event)
+{
+    Line* line = edgeAt(event->scenePos());
+    if (parentScene->getMode() != Scene::SelectObject || !line) {
+        event->ignore();
+        return;
+    }
+    int index = indexOf.value(line);
+    if (event->modifiers() & Qt::ControlModifier) {
+        setSelected(index, !selected[index]);
+    }
+    else {
+        // Like a click on a selectable item, it unselects everything else
+        parentScene->clearSelection();
+        clearSelection();
+        setSelected(index, true);
+    }
+    event->accept();
+}
+
+void EdgeLayer::hoverMoveEvent(QGraphicsSceneHoverEvent *event)
+{
+    Line* line = edgeAt(event->scenePos());
+    setToolTip(line ? line->valueToolTip() : QString());
+}
@@ -0,0 +1,129 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief A single item drawing all connections of a scene.
+ * @file edgelayer.h
+ */
+
+#ifndef EDGELAYER_H
+#define EDGELAYER_H
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QHash>
+#include <QList>
+#include <QVector>
+
+class Line;
+class Scene;
+
+/**
+ * @brief The EdgeLayer class draws the connections of a scene in one item instead of one item per line.
+ * The lines stay out of the scene, the layer keeps their geometry in one array and finds them
+ * by a grid of square cells.
+ */
+class EdgeLayer : public QGraphicsItem
+{
+public:
+    enum { Type = UserType + 3 };
+    /**
+     * @brief CellSize is the size of the cells of the grid used to find lines.
+     */
+    static const int CellSize = 256;
+    /**
+     * @brief EdgeLayer is the constructor.
+     * @param scene Scene whose lines are drawn.
+     */
+    EdgeLayer(Scene* scene);
+    /**
+     * @brief type returns the type of the layer.
+     * @return type of the layer.
+     */
+    int type() const;
+    /**
+     * @brief addEdge starts drawing a line.
+     * @param line Line which is not in the scene.
+     */
+    void addEdge(Line* line);
+    /**
+     * @brief removeEdge stops drawing a line.
+     * @param line Line drawn by the layer.
+     */
+    void removeEdge(Line* line);
+    /**
+     * @brief updateEdge takes the new geometry of a line.
+     * @param line Line drawn by the layer.
+     */
+    void updateEdge(Line* line);
+    /**
+     * @brief edgeAt finds the line nearest to a point.
+     * @param position Point in the scene.
+     * @return The nearest line not farther than a few pixels, NULL if there is none.
+     */
+    Line* edgeAt(const QPointF &position) const;
+    /**
+     * @brief edges returns all lines drawn by the layer.
+     * @return list of lines.
+     */
+    QList<Line*> edges() const;
+    /**
+     * @brief selectedEdges returns the selected lines.
+     * @return list of selected lines.
+     */
+    QList<Line*> selectedEdges() const;
+    /**
+     * @brief clearSelection unselects all lines.
+     */
+    void clearSelection();
+    /**
+     * @brief boundingRect returns the area of all lines.
+     * @return the area of all lines.
+     */
+    QRectF boundingRect() const;
+    /**
+     * @brief contains checks if a point is on a line, so only lines take mouse events.
+     * @param point Point in the layer's coordinates.
+     * @return bool value. True if a line is near the point, otherwise it is False.
+     */
+    bool contains(const QPointF &point) const;
+    /**
+     * @brief paint draws the visible lines, all lines of one style by one call.
+     * @param painter A QPainter.
+     * @param option Options, its exposed rectangle limits the drawn lines.
+     * @param parent A QWidget* parent. Doesn't use.
+     */
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent);
+protected:
+    /**
+     * @brief mousePressEvent selects the clicked line in the select mode, with Ctrl it toggles its selection.
+     * @param event A mouse event.
+     */
+    void mousePressEvent(QGraphicsSceneMouseEvent *event);
+    /**
+     * @brief hoverMoveEvent shows the value of the line under the mouse in a tooltip.
+     * @param event A mouse hover event.
+     */
+    void hoverMoveEvent(QGraphicsSceneHoverEvent *event);
+private:
+    Scene* parentScene; /**< scene whose lines are drawn.*/
+    QVector<QLineF> segments; /**< geometry of the lines.*/
+    QVector<Line*> owners; /**< lines by their index in segments.*/
+    QVector<bool> selected; /**< selection of the lines by their index in segments.*/
+    int selectedCount; /**< number of selected lines.*/
+    QHash<Line*, int> indexOf; /**< index of each line in segments.*/
+    QHash<qint64, QVector<int> > grid; /**< indexes of the lines passing through each cell.*/
+    QRectF bounds; /**< area of all lines, it only grows while there are any.*/
+    QVector<unsigned> paintMark; /**< epoch in which a line was drawn, so it is drawn once.*/
+    unsigned paintEpoch; /**< current epoch of paintMark.*/
+
+    QList<qint64> cellsOf(const QLineF &segment) const;
+    void insertIntoGrid(int index);
+    void removeFromGrid(int index);
+    void setSelected(int index, bool isSelected);
+};
+
+#endif // EDGELAYER_H
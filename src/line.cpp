@@ -12,26 +12,63 @@
 #include "line.h"
 #include "port.h"
 
-Line::Line(const QLineF &line, Port* endPort) : QGraphicsLineItem(line)
+#include <QStyleOptionGraphicsItem>
+
+/** Below this scale, lines are drawn as thin lines without antialiasing. */
+static const qreal LowDetail = 0.5;
+
+Line::Line(const QLineF &line, Port* startPort, Port* endPort) : QGraphicsLineItem(line)
 {
+    this->startPort = startPort;
     this->endPort = endPort;
     setAcceptHoverEvents(true);
+    // The scene lets the line be selected only in its select mode
+    setFlag(ItemIsSelectable);
     setZValue(-1);
 }
 
+Port* Line::getStartPort()
+{
+    return startPort;
+}
+
+Port* Line::getEndPort()
+{
+    return endPort;
+}
+
+void Line::reconnect(const QLineF &line, Port* startPort, Port* endPort)
+{
+    setLine(line);
+    this->startPort = startPort;
+    this->endPort = endPort;
+    setSelected(false);
+}
+
 void Line::hoverMoveEvent(QGraphicsSceneHoverEvent* event)
 {
     Q_UNUSED(event)
 
+    setToolTip(valueToolTip());
+}
+
+QString Line::valueToolTip()
+{
     if (endPort->areDataSet())
-        setToolTip(QString::number(endPort->getData()));
-    else
-        setToolTip("No value");
+        return QString::number(endPort->getData());
+    return "No value";
 }
 
 void Line::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent){
     Q_UNUSED(parent);
-    Q_UNUSED(option);
+
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < LowDetail) {
+        // A cosmetic pen is the fastest to stroke, the view restores the hints for the next item
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        painter->setPen(QPen(Qt::black, 0));
+        painter->drawLine(line());
+        return;
+    }
 
     painter->setPen(QPen(QBrush(Qt::black), 3));
     painter->drawLine(line());
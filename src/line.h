@@ -26,7 +26,35 @@ class Port;
 class Line : public QGraphicsLineItem
 {
 public:
-    Line(const QLineF &line, Port* endPort);
+    /**
+     * @brief Line is the constructor.
+     * @param line Geometry of the line.
+     * @param startPort Output port where the line starts.
+     * @param endPort Input port where the line ends.
+     */
+    Line(const QLineF &line, Port* startPort, Port* endPort);
+    /**
+     * @brief getStartPort returns the output port where the line starts.
+     * @return the output port.
+     */
+    Port* getStartPort();
+    /**
+     * @brief getEndPort returns the input port where the line ends.
+     * @return the input port.
+     */
+    Port* getEndPort();
+    /**
+     * @brief reconnect reuses the line for another connection.
+     * @param line Geometry of the line.
+     * @param startPort Output port where the line starts.
+     * @param endPort Input port where the line ends.
+     */
+    void reconnect(const QLineF &line, Port* startPort, Port* endPort);
+    /**
+     * @brief valueToolTip returns the text of the tooltip of the line, the value it passes.
+     * @return the value or "No value".
+     */
+    QString valueToolTip();
 private:
     /**
      * @brief hoverMoveEvent Overridden method for handling hover events. Ensures that tooltip with a line value pops up.
@@ -36,12 +64,13 @@ private:
     /**
      * @brief paint Overriden method for line drawing.
      * @param painter A QPainter.
-     * @param option Options.
+     * @param option Options, a low level of detail draws a thin line.
      * @param parent A QWidget* parent.
      */
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent);
 
-    Port* endPort;
+    Port* startPort; /**< output port where the line starts.*/
+    Port* endPort; /**< input port where the line ends.*/
 };
 
 #endif // LINE_H
@@ -13,6 +13,22 @@
 
 #include "mainwindow.h"
 #include "block.h"
+#include "binaryscheme.h"
+#include "schemereader.h"
+
+/**
+ * @brief AutosaveInterval is the time between two autosaves in milliseconds.
+ */
+static const int AutosaveInterval = 60 * 1000;
+/**
+ * @brief ZoomStep is the change of the scale by one zoom action or one step of the wheel.
+ */
+static const qreal ZoomStep = 1.25;
+/**
+ * @brief MinZoom and MaxZoom limit the scale of the view.
+ */
+static const qreal MinZoom = 0.05;
+static const qreal MaxZoom = 8;
 
 MainWindow::MainWindow()
 {
@@ -21,15 +37,40 @@ MainWindow::MainWindow()
     setMinimumSize(160, 160);
     view = new QGraphicsView(scene);
     view->setRenderHints(QPainter::Antialiasing);
+    // Zooming keeps the point under the mouse in place
+    view->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+    view->viewport()->installEventFilter(this);
     setCentralWidget(view);
+    connect(view->horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewChanged()));
+    connect(view->verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(viewChanged()));
+    connect(view->horizontalScrollBar(), SIGNAL(rangeChanged(int,int)), this, SLOT(viewChanged()));
+    connect(view->verticalScrollBar(), SIGNAL(rangeChanged(int,int)), this, SLOT(viewChanged()));
     setWindowTitle("BlockEditor");
     QLocale().setDefault(QLocale::C);
     statusBar()->showMessage("Ready", 2000);
 
+    saver = new SchemeSaver(this);
+    connect(saver, SIGNAL(progress(int)), this, SLOT(saveProgress(int)));
+    connect(saver, SIGNAL(finished(QString,bool,quint64,bool,QString)),
+            this, SLOT(saveFinished(QString,bool,quint64,bool,QString)));
+    savedRevision = scene->schemeModel()->revision();
+    journal = new SchemeJournal(scene->schemeModel());
+    scene->schemeModel()->setListener(journal);
+
+    autosaveTimer = new QTimer(this);
+    connect(autosaveTimer, SIGNAL(timeout()), this, SLOT(autosave()));
+    autosaveTimer->start(AutosaveInterval);
+
     createActions();
     createMenus();
 }
 
+MainWindow::~MainWindow()
+{
+    scene->schemeModel()->setListener(NULL);
+    delete journal;
+}
+
 void MainWindow::aboutQt()
 {
     statusBar()->showMessage(tr("Invoked <b>Help|About Qt</b>"), 2000);
@@ -79,6 +120,21 @@ void MainWindow::createActions()
     calculateNextButton->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_X));
     resetButton = new QAction("Reset", this);
     resetButton->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_R));
+    liveUpdateButton = new QAction("Live update", this);
+    liveUpdateButton->setCheckable(true);
+    liveUpdateButton->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_L));
+    virtualizedButton = new QAction("Virtualized view", this);
+    virtualizedButton->setCheckable(true);
+    virtualizedButton->setStatusTip("Keep items only for the blocks near the visible part of the scheme");
+    edgeLayerButton = new QAction("Edge layer", this);
+    edgeLayerButton->setCheckable(true);
+    edgeLayerButton->setStatusTip("Draw all connections at once, they are selected by a click only");
+    zoomInButton = new QAction("Zoom in", this);
+    zoomInButton->setShortcut(QKeySequence::ZoomIn);
+    zoomOutButton = new QAction("Zoom out", this);
+    zoomOutButton->setShortcut(QKeySequence::ZoomOut);
+    resetZoomButton = new QAction("Reset zoom", this);
+    resetZoomButton->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_0));
     clearButton = new QAction("Clear", this);
     clearButton->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_C));
 
@@ -97,6 +153,12 @@ void MainWindow::createActions()
     connect(calculateAllButton, SIGNAL(triggered()), this, SLOT(calculateAll()));
     connect(calculateNextButton, SIGNAL(triggered()), this, SLOT(calculateNext()));
     connect(resetButton, SIGNAL(triggered()), this, SLOT(reset()));
+    connect(liveUpdateButton, SIGNAL(toggled(bool)), this, SLOT(liveUpdateToggled(bool)));
+    connect(virtualizedButton, SIGNAL(toggled(bool)), this, SLOT(virtualizedToggled(bool)));
+    connect(edgeLayerButton, SIGNAL(toggled(bool)), this, SLOT(edgeLayerToggled(bool)));
+    connect(zoomInButton, SIGNAL(triggered()), this, SLOT(zoomIn()));
+    connect(zoomOutButton, SIGNAL(triggered()), this, SLOT(zoomOut()));
+    connect(resetZoomButton, SIGNAL(triggered()), this, SLOT(resetZoom()));
     connect(clearButton, SIGNAL(triggered()), this, SLOT(clear()));
 
     helpButtonAct = new QAction("Help", this);
@@ -132,6 +194,7 @@ void MainWindow::createActions()
     drawingToolBar->addAction(calculateAllButton);
     drawingToolBar->addAction(calculateNextButton);
     drawingToolBar->addAction(resetButton);
+    drawingToolBar->addAction(liveUpdateButton);
 
     blocksToolBar = new QToolBar;
     addToolBar(Qt::LeftToolBarArea, blocksToolBar);
@@ -160,6 +223,14 @@ void MainWindow::createActions()
     saveAct->setStatusTip(tr("Save the document to disk"));
     connect(saveAct, &QAction::triggered, this, &MainWindow::save);
 
+    journalAct = new QAction(tr("&Journal mode"), this);
+    journalAct->setCheckable(true);
+    journalAct->setStatusTip(tr("Save only the edits, appended to a journal next to the file"));
+
+    compactAct = new QAction(tr("&Compact"), this);
+    compactAct->setStatusTip(tr("Save the whole scheme to its file and drop its journal"));
+    connect(compactAct, &QAction::triggered, this, &MainWindow::compact);
+
     exitAct = new QAction(tr("E&xit"), this);
     exitAct->setShortcuts(QKeySequence::Quit);
     exitAct->setStatusTip(tr("Exit the application"));
@@ -182,6 +253,8 @@ void MainWindow::createMenus()
     fileMenu->addAction(newAct);
     fileMenu->addAction(openAct);
     fileMenu->addAction(saveAct);
+    fileMenu->addAction(journalAct);
+    fileMenu->addAction(compactAct);
     fileMenu->addSeparator();
     fileMenu->addAction(exitAct);
 
@@ -195,6 +268,15 @@ void MainWindow::createMenus()
     calculationMenu->addAction(calculateAllButton);
     calculationMenu->addAction(calculateNextButton);
     calculationMenu->addAction(resetButton);
+    calculationMenu->addAction(liveUpdateButton);
+
+    viewMenu = menuBar()->addMenu(tr("&View"));
+    viewMenu->addAction(virtualizedButton);
+    viewMenu->addAction(edgeLayerButton);
+    viewMenu->addSeparator();
+    viewMenu->addAction(zoomInButton);
+    viewMenu->addAction(zoomOutButton);
+    viewMenu->addAction(resetZoomButton);
 
     blocksMenu = menuBar()->addMenu(tr("&Blocks"));
     blocksMenu->addAction(addBlock);
@@ -220,6 +302,9 @@ void MainWindow::newFile() {
                                   QMessageBox::Yes|QMessageBox::No);
     if (reply == QMessageBox::Yes) {
       clear();
+      currentFile.clear();
+      journal->discard();
+      savedRevision = scene->schemeModel()->revision();
     }
 }
 
@@ -330,70 +415,208 @@ void MainWindow::exit()
 }
 
 void MainWindow::save() {
-    QString fileName =  QFileDialog::getSaveFileName(this, tr("Save a scheme"), "", tr("All Files (*)"));
-    scene->saveBlocksToFile(fileName);
+    if (journalAct->isChecked() && !currentFile.isEmpty()) {
+        saveJournal();
+        return;
+    }
+    QString fileName =  QFileDialog::getSaveFileName(this, tr("Save a scheme"), "",
+                                                     tr("All Files (*);;Binary schemes (*.bsch);;"
+                                                        "Compressed schemes (*.schz)"));
+    if (fileName.isEmpty())
+        return;
+    saveWhole(fileName);
 }
 
-void MainWindow::open() {
-    QString fileName =  QFileDialog::getOpenFileName(this, tr("Open a scheme"), "", tr("All Files (*)"));
-    QFile file(fileName);
+void MainWindow::compact()
+{
+    if (currentFile.isEmpty()) {
+        save();
+        return;
+    }
+    saveWhole(currentFile);
+}
+
+void MainWindow::saveWhole(const QString &fileName)
+{
+    // The scheme is written on a worker thread, the editor stays usable meanwhile.
+    // The journal is kept until the file really contains its edits.
+    journalMarks.append(journal->mark());
+    saver->save(*scene->schemeModel(), fileName);
+    statusBar()->showMessage("Saving...");
+}
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning((QWidget*)parent(), "Unable to open file", file.errorString());
+void MainWindow::saveJournal()
+{
+    // The running save drops the journal file when it finishes
+    if (!journalMarks.isEmpty()) {
+        statusBar()->showMessage("Wait until the running save finishes.", 2000);
         return;
     }
+    if (!journal->hasEdits()) {
+        statusBar()->showMessage("No changes to save.", 2000);
+        return;
+    }
+    QString error;
+    if (!journal->save(SchemeJournal::fileName(currentFile), &error)) {
+        QMessageBox::warning(this, "Unable to save journal", error);
+        return;
+    }
+    savedRevision = scene->schemeModel()->revision();
+    statusBar()->showMessage("Edits saved to the journal.", 2000);
+}
 
-    QTextStream in(&file);
-    in.readLine(); // Get rid of the first line
-
-    QList<Scene::BlockInfo> loadList;
-    while (!in.atEnd())
-    {
-        QString line = in.readLine();
-        QRegExp re("[\\d\\s-]*");
-        if (!re.exactMatch(line)){
-            QMessageBox::warning((QWidget*)parent(), "Corrupted file", "File is corrupted.");
-            clear();
-            return;
-        }
-        QStringList list = line.split(QRegExp("\\s+"), QString::SkipEmptyParts);
+void MainWindow::virtualizedToggled(bool checked)
+{
+    scene->setVirtualized(checked);
+    viewChanged();
+}
 
-        if (list.size()-5 < 0 || (list.size()-5)%2 != 0 || QString(list.at(4)).toInt() != (list.size()-5)/2) {
-            QMessageBox::warning((QWidget*)parent(), "Corrupted file", "File is corrupted.");
-            clear();
-            return;
-        }
+void MainWindow::edgeLayerToggled(bool checked)
+{
+    scene->setEdgeLayer(checked);
+}
+
+void MainWindow::viewChanged()
+{
+    scene->setVisibleArea(view->mapToScene(view->viewport()->rect()).boundingRect());
+}
+
+void MainWindow::zoomIn()
+{
+    zoomBy(ZoomStep);
+}
 
-        QString type = list.at(0);
-        QString id = list.at(1);
-        QString x = list.at(2);
-        QString y = list.at(3);
-        QString conns = list.at(4);
-
-        Scene::BlockInfo block;
-        block.type = Block::blockType(type.toInt());
-        block.id = id.toInt();
-        block.x = x.toInt();
-        block.y = y.toInt();
-        for (int i = 0; i < conns.toInt(); i++) {
-            QString id = list.at(5 + 2*i);
-            QString port = list.at(6 + 2*i);
-            QPair<int, int> pair;
-            pair.first = id.toInt();
-            pair.second = port.toInt();
-            block.connections.append(pair);
+void MainWindow::zoomOut()
+{
+    zoomBy(1 / ZoomStep);
+}
+
+void MainWindow::resetZoom()
+{
+    view->resetTransform();
+    viewChanged();
+}
+
+void MainWindow::zoomBy(qreal factor)
+{
+    qreal zoom = view->transform().m11();
+    factor = qBound(MinZoom / zoom, factor, MaxZoom / zoom);
+    view->scale(factor, factor);
+    // The scroll bars do not have to move, the visible part of the scene changes anyway
+    viewChanged();
+}
+
+bool MainWindow::eventFilter(QObject* watched, QEvent* event)
+{
+    // The wheel alone scrolls as usual
+    if (watched == view->viewport() && event->type() == QEvent::Wheel) {
+        QWheelEvent* wheel = (QWheelEvent*)event;
+        if (wheel->modifiers() & Qt::ControlModifier) {
+            zoomBy(qPow(ZoomStep, wheel->angleDelta().y() / 120.0));
+            return true;
         }
-        loadList.append(block);
     }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::autosave()
+{
+    if (saver->isSaving() || scene->schemeModel()->revision() == savedRevision)
+        return;
+    saver->save(*scene->schemeModel(), autosaveFileName(), true);
+}
+
+QString MainWindow::autosaveFileName() const
+{
+    // Autosaves use the binary format, it is the fastest to write
+    if (currentFile.isEmpty())
+        return QDir(QDir::tempPath()).filePath(QString("blockeditor.autosave.") + BinaryScheme::Suffix);
+    QFileInfo info(currentFile);
+    return info.dir().filePath(info.completeBaseName() + ".autosave." + BinaryScheme::Suffix);
+}
+
+void MainWindow::saveProgress(int percent)
+{
+    statusBar()->showMessage(QString("Saving... %1%").arg(percent));
+}
+
+void MainWindow::saveFinished(const QString &fileName, bool autosave, quint64 revision, bool saved, const QString &error)
+{
+    qint64 mark = autosave ? 0 : journalMarks.takeFirst();
+    if (!saved) {
+        if (autosave)
+            statusBar()->showMessage("Autosave failed: " + error, 4000);
+        else
+            QMessageBox::warning(this, "Unable to save file", error);
+        return;
+    }
+    statusBar()->showMessage(autosave ? "Autosaved to " + fileName : "Saved to " + fileName, 2000);
+    if (autosave)
+        return;
+
+    // The file contains every edit up to the snapshot, an old journal would apply them twice,
+    // even if another scheme is open by now
+    QFile::remove(SchemeJournal::fileName(fileName));
+    // Revisions only grow, an older one was overtaken, e.g. by opening another file meanwhile
+    if (revision < savedRevision)
+        return;
+    // Edits made while the file was being written are not in it, they stay in the journal
+    if (scene->schemeModel()->revision() == revision)
+        journal->discard();
+    else
+        journal->dropUntil(mark);
+    currentFile = fileName;
+    savedRevision = revision;
+}
+
+void MainWindow::open() {
+    QString fileName =  QFileDialog::getOpenFileName(this, tr("Open a scheme"), "", tr("All Files (*)"));
+    if (fileName.isEmpty())
+        return;
 
+    QString error;
+    QString warning;
+    if (!openFile(fileName, &error, &warning))
+        QMessageBox::warning(this, "Unable to open file", error);
+    else if (!warning.isEmpty())
+        QMessageBox::warning(this, "Some connections were not loaded", warning);
+}
+
+bool MainWindow::openFile(const QString &fileName, QString* error, QString* warning)
+{
+    // Loading is not an edit, the journal records only what the user does afterwards
+    scene->schemeModel()->setListener(NULL);
     clear();
-    foreach (Scene::BlockInfo entry, loadList) {
-        QPoint position = QPoint(entry.x, entry.y);
-        createBlock(entry.type, position, entry.id);
+    scene->beginLoad();
+    bool loaded;
+    // Binary files are recognized by their header, anything else is read as text
+    if (BinaryScheme::isBinaryFile(fileName))
+        loaded = BinaryScheme::read(fileName, scene, error, warning);
+    else
+        loaded = SchemeReader::read(fileName, scene, error, warning);
+    if (loaded)
+        loaded = SchemeJournal::replay(SchemeJournal::fileName(fileName), scene, error);
+    scene->endLoad();
+
+    if (!loaded) {
+        clear();
+        currentFile.clear();
     }
-    scene->loadConnections(loadList);
+    else
+        currentFile = fileName;
+    journal->discard();
+    scene->schemeModel()->setListener(journal);
+    savedRevision = scene->schemeModel()->revision();
+    if (loaded) {
+        ensureModeIsSelect();
+        viewChanged();
+    }
+    return loaded;
+}
 
-    file.close();
+bool MainWindow::isSaving() const
+{
+    return saver->isSaving();
 }
 
 void MainWindow::calculateNext()
@@ -439,6 +662,14 @@ void MainWindow::reset()
     scene->resetCalculation();
 }
 
+void MainWindow::liveUpdateToggled(bool checked)
+{
+    ensureModeIsSelect();
+    scene->setLiveUpdate(checked);
+    if (checked)
+        statusBar()->showMessage("Outputs are updated whenever an input changes.", 2000);
+}
+
 bool MainWindow::calculationReady()
 {
     if (scene->numberOfBlocks() == 0) {
@@ -449,8 +680,16 @@ bool MainWindow::calculationReady()
         statusBar()->showMessage("All input ports must be connected.", 2000);
         return false;
     }
-    if (scene->containsLoops()) {
-        statusBar()->showMessage("Scheme must not contain loops.", 2000);
+    QList<Block*> loop;
+    if (scene->containsLoops(&loop)) {
+        // Select the blocks of the loop, so the user can see where it is
+        QStringList ids;
+        scene->clearSelection();
+        foreach (Block* block, loop) {
+            ids.append(QString::number(block->idBlock()));
+            block->setSelected(true);
+        }
+        statusBar()->showMessage("Scheme must not contain loops. Loop through blocks: " + ids.join(" -> "), 4000);
         return false;
     }
     if (!scene->allInputBlocksInitialized()) {
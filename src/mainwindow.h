@@ -20,6 +20,8 @@
 
 #include "scene.h"
 #include "block.h"
+#include "schemesaver.h"
+#include "schemejournal.h"
 /**
  * @brief The MainWindow class contains the information about application's buttons.
  */
@@ -28,6 +30,25 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 public:
     MainWindow();
+    ~MainWindow();
+    /**
+     * @brief openFile replaces the scheme by the one in a file, with its journal applied.
+     * @param fileName Full path to the file.
+     * @param error Description of the problem if the file cannot be opened.
+     * @param warning Description of connections which were not loaded, empty if all were.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    bool openFile(const QString &fileName, QString* error, QString* warning);
+    /**
+     * @brief saveWhole saves the whole scheme to a file in the background, its journal is removed once the file is written.
+     * @param fileName Full path to the file.
+     */
+    void saveWhole(const QString &fileName);
+    /**
+     * @brief isSaving checks if a background save is running or waiting.
+     * @return true if the saver is busy.
+     */
+    bool isSaving() const;
 private slots:
     /**
      * @brief linesActionGroupClicked creates a group of a line's mode(to move blocks, to create connection between blocks).
@@ -84,6 +105,54 @@ private slots:
      * @brief save save a file, when clicked the button "Save".
      */
     void save();
+    /**
+     * @brief compact saves the whole scheme to its file, which makes its journal unnecessary.
+     */
+    void compact();
+    /**
+     * @brief virtualizedToggled turns on or off the virtualized view of the scene.
+     * @param checked True if only blocks near the visible part should have items.
+     */
+    void virtualizedToggled(bool checked);
+    /**
+     * @brief edgeLayerToggled turns on or off drawing of the connections by one item.
+     * @param checked True if the connections should be drawn by the edge layer.
+     */
+    void edgeLayerToggled(bool checked);
+    /**
+     * @brief viewChanged tells the scene which part of it is visible, so it can create or release items.
+     */
+    void viewChanged();
+    /**
+     * @brief zoomIn makes the scheme in the view larger.
+     */
+    void zoomIn();
+    /**
+     * @brief zoomOut makes the scheme in the view smaller.
+     */
+    void zoomOut();
+    /**
+     * @brief resetZoom shows the scheme in its real size.
+     */
+    void resetZoom();
+    /**
+     * @brief autosave saves a changed scheme next to the current file in the background.
+     */
+    void autosave();
+    /**
+     * @brief saveProgress shows the progress of a background save in the status bar.
+     * @param percent Percentage of the scheme written so far.
+     */
+    void saveProgress(int percent);
+    /**
+     * @brief saveFinished reports the result of a background save.
+     * @param fileName File the scheme was saved to.
+     * @param autosave True if it was an autosave.
+     * @param revision Revision of the saved snapshot of the model.
+     * @param saved True if the scheme was saved.
+     * @param error Description of the problem if it was not.
+     */
+    void saveFinished(const QString &fileName, bool autosave, quint64 revision, bool saved, const QString &error);
     /**
      * @brief open open a file, when clicked the button "Open".
      */
@@ -108,6 +177,11 @@ private slots:
      * @brief reset resets output values.
      */
     void reset();
+    /**
+     * @brief liveUpdateToggled turns on or off the recalculation of changed inputs.
+     * @param checked True if live update is on.
+     */
+    void liveUpdateToggled(bool checked);
     /**
      * @brief clearing clears the scene.
      */
@@ -116,6 +190,14 @@ private slots:
      * @brief exit Exits the application.
      */
     void exit();
+protected:
+    /**
+     * @brief eventFilter zooms the view when the wheel is turned with Ctrl held.
+     * @param watched The viewport of the view.
+     * @param event An event of the viewport.
+     * @return true if the event was used for zooming.
+     */
+    bool eventFilter(QObject* watched, QEvent* event);
 private:
     QGraphicsView* view;
     Scene* scene;
@@ -126,6 +208,12 @@ private:
     QAction* calculateAllButton;
     QAction* calculateNextButton;
     QAction* resetButton;
+    QAction* liveUpdateButton;
+    QAction* virtualizedButton;
+    QAction* edgeLayerButton;
+    QAction* zoomInButton;
+    QAction* zoomOutButton;
+    QAction* resetZoomButton;
     QAction* clearButton;
     QAction* helpButtonAct;
     QAction* newButtonAct;
@@ -147,9 +235,12 @@ private:
     QMenu* editMenu;
     QMenu* calculationMenu;
     QMenu* blocksMenu;
+    QMenu* viewMenu;
     QAction *newAct;
     QAction *openAct;
     QAction *saveAct;
+    QAction *journalAct;
+    QAction *compactAct;
     QAction *exitAct;
     QAction *aboutAct;
     QAction *aboutQtAct;
@@ -158,7 +249,17 @@ private:
     QToolBar* blocksToolBar;
     QToolBar* controlToolBar;
 
+    SchemeSaver* saver;
+    QTimer* autosaveTimer;
+    QString currentFile; /**< file the scheme was opened from or saved to.*/
+    unsigned long long savedRevision; /**< revision of the model when it was last saved.*/
+    SchemeJournal* journal; /**< edits made since the last save.*/
+    QList<qint64> journalMarks; /**< journal position of each explicit save in progress, in order.*/
+
     bool calculationReady();
+    QString autosaveFileName() const;
+    void saveJournal();
+    void zoomBy(qreal factor);
     void ensureModeIsSelect();
     void createActions();
     void createMenus();
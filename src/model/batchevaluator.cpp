@@ -0,0 +1,284 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the batch evaluation and its SIMD kernels.
+ * @file batchevaluator.cpp
+ *
+ *
+ */
+
+#include "batchevaluator.h"
+
+#include <cmath>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Kernels calculate one block over a range of a column. Two-input blocks read
+ * both columns, one-input blocks ignore the second one. They return true if
+ * a division by zero occured in the range.
+ */
+
+static bool kernelScalar(SchemeModel::BlockType type, const double* a, const double* b, double* out, size_t n)
+{
+    bool divByZero = false;
+    size_t i;
+    switch (type) {
+    case SchemeModel::Add:
+        for (i = 0; i < n; i++) out[i] = a[i] + b[i];
+        break;
+    case SchemeModel::Sub:
+        for (i = 0; i < n; i++) out[i] = a[i] - b[i];
+        break;
+    case SchemeModel::Mul:
+        for (i = 0; i < n; i++) out[i] = a[i] * b[i];
+        break;
+    case SchemeModel::Div:
+        for (i = 0; i < n; i++) {
+            divByZero |= (b[i] == 0);
+            out[i] = a[i] / b[i];
+        }
+        break;
+    case SchemeModel::Pow2:
+        for (i = 0; i < n; i++) out[i] = a[i] * a[i];
+        break;
+    case SchemeModel::PowX:
+        for (i = 0; i < n; i++) out[i] = std::pow(a[i], b[i]);
+        break;
+    case SchemeModel::Sqrt:
+        for (i = 0; i < n; i++) out[i] = std::sqrt(a[i]);
+        break;
+    default:
+        break;
+    }
+    return divByZero;
+}
+
+#ifdef BATCH_X86
+
+static bool kernelSSE2(SchemeModel::BlockType type, const double* a, const double* b, double* out, size_t n)
+{
+    // There is no vector pow, the tail and PowX are left to the scalar kernel
+    if (type == SchemeModel::PowX)
+        return kernelScalar(type, a, b, out, n);
+
+    const size_t vecEnd = n - n % 2;
+    __m128d zeroMask = _mm_setzero_pd();
+    const __m128d zero = _mm_setzero_pd();
+    size_t i;
+    switch (type) {
+    case SchemeModel::Add:
+        for (i = 0; i < vecEnd; i += 2)
+            _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Sub:
+        for (i = 0; i < vecEnd; i += 2)
+            _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Mul:
+        for (i = 0; i < vecEnd; i += 2)
+            _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Div:
+        for (i = 0; i < vecEnd; i += 2) {
+            __m128d divisor = _mm_loadu_pd(b + i);
+            zeroMask = _mm_or_pd(zeroMask, _mm_cmpeq_pd(divisor, zero));
+            _mm_storeu_pd(out + i, _mm_div_pd(_mm_loadu_pd(a + i), divisor));
+        }
+        break;
+    case SchemeModel::Pow2:
+        for (i = 0; i < vecEnd; i += 2) {
+            __m128d x = _mm_loadu_pd(a + i);
+            _mm_storeu_pd(out + i, _mm_mul_pd(x, x));
+        }
+        break;
+    case SchemeModel::Sqrt:
+        for (i = 0; i < vecEnd; i += 2)
+            _mm_storeu_pd(out + i, _mm_sqrt_pd(_mm_loadu_pd(a + i)));
+        break;
+    default:
+        return false;
+    }
+
+    bool divByZero = _mm_movemask_pd(zeroMask) != 0;
+    return kernelScalar(type, a + vecEnd, b + vecEnd, out + vecEnd, n - vecEnd) || divByZero;
+}
+
+__attribute__((target("avx2")))
+static bool kernelAVX2(SchemeModel::BlockType type, const double* a, const double* b, double* out, size_t n)
+{
+    if (type == SchemeModel::PowX)
+        return kernelScalar(type, a, b, out, n);
+
+    const size_t vecEnd = n - n % 4;
+    __m256d zeroMask = _mm256_setzero_pd();
+    const __m256d zero = _mm256_setzero_pd();
+    size_t i;
+    switch (type) {
+    case SchemeModel::Add:
+        for (i = 0; i < vecEnd; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Sub:
+        for (i = 0; i < vecEnd; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Mul:
+        for (i = 0; i < vecEnd; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        break;
+    case SchemeModel::Div:
+        for (i = 0; i < vecEnd; i += 4) {
+            __m256d divisor = _mm256_loadu_pd(b + i);
+            zeroMask = _mm256_or_pd(zeroMask, _mm256_cmp_pd(divisor, zero, _CMP_EQ_OQ));
+            _mm256_storeu_pd(out + i, _mm256_div_pd(_mm256_loadu_pd(a + i), divisor));
+        }
+        break;
+    case SchemeModel::Pow2:
+        for (i = 0; i < vecEnd; i += 4) {
+            __m256d x = _mm256_loadu_pd(a + i);
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(x, x));
+        }
+        break;
+    case SchemeModel::Sqrt:
+        for (i = 0; i < vecEnd; i += 4)
+            _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_loadu_pd(a + i)));
+        break;
+    default:
+        return false;
+    }
+
+    bool divByZero = _mm256_movemask_pd(zeroMask) != 0;
+    return kernelScalar(type, a + vecEnd, b + vecEnd, out + vecEnd, n - vecEnd) || divByZero;
+}
+
+#endif // BATCH_X86
+
+BatchEvaluator::BatchEvaluator(const SchemeModel* model)
+{
+    this->model = model;
+    kernelIsa = detectIsa();
+}
+
+BatchEvaluator::Isa BatchEvaluator::detectIsa()
+{
+#ifdef BATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SSE2;
+#endif
+    return Scalar;
+}
+
+BatchEvaluator::Isa BatchEvaluator::isa() const
+{
+    return kernelIsa;
+}
+
+void BatchEvaluator::setIsa(Isa isa)
+{
+    kernelIsa = isa;
+}
+
+bool BatchEvaluator::bindInput(int id, const double* column)
+{
+    int slot = model->slotOf(id);
+    if (slot < 0 || model->blockAt(slot).type != SchemeModel::Input)
+        return false;
+    if (bound.size() < size_t(model->slotCount()))
+        bound.resize(model->slotCount(), NULL);
+    bound[slot] = column;
+    return true;
+}
+
+bool BatchEvaluator::prepare(size_t rows, std::vector<int>* plan)
+{
+    if (!model->buildPlan(plan) || !model->allInputPortsConnected())
+        return false;
+
+    size_t slots = size_t(model->slotCount());
+    bound.resize(slots, NULL);
+    columns.assign(slots, NULL);
+    storage.resize(slots);
+
+    for (size_t i = 0; i < plan->size(); i++) {
+        int slot = (*plan)[i];
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        switch (block.type) {
+        case SchemeModel::Input:
+            if (!bound[slot])
+                return false;
+            columns[slot] = bound[slot];
+            break;
+        case SchemeModel::Output:
+            // An output only shows the column of its source, no need to copy it
+            columns[slot] = columns[model->edgeAt(block.inEdges[0]).from];
+            break;
+        default:
+            storage[slot].resize(rows);
+            columns[slot] = storage[slot].data();
+            break;
+        }
+    }
+    return true;
+}
+
+bool BatchEvaluator::run(size_t rows, SchemeModel::EvalError* err)
+{
+    if (err)
+        *err = SchemeModel::NoErr;
+    std::vector<int> plan;
+    if (!prepare(rows, &plan))
+        return false;
+
+    bool divByZero = false;
+    for (size_t i = 0; i < plan.size(); i++) {
+        divByZero |= calculateBlock(plan[i], 0, rows);
+    }
+    if (divByZero && err)
+        *err = SchemeModel::DivByZero;
+    return true;
+}
+
+bool BatchEvaluator::calculateBlock(int slot, size_t begin, size_t end)
+{
+    const SchemeModel::BlockRecord& block = model->blockAt(slot);
+    if (block.type == SchemeModel::Input || block.type == SchemeModel::Output)
+        return false;
+
+    // One-input blocks get their only column twice, the kernel ignores the second one
+    const double* a = columns[model->edgeAt(block.inEdges[0]).from] + begin;
+    const double* b = a;
+    if (SchemeModel::inPortCount(block.type) > 1)
+        b = columns[model->edgeAt(block.inEdges[1]).from] + begin;
+    double* out = storage[slot].data() + begin;
+    size_t n = end - begin;
+
+    switch (kernelIsa) {
+#ifdef BATCH_X86
+    case AVX2:
+        return kernelAVX2(block.type, a, b, out, n);
+    case SSE2:
+        return kernelSSE2(block.type, a, b, out, n);
+#endif
+    default:
+        return kernelScalar(block.type, a, b, out, n);
+    }
+}
+
+const double* BatchEvaluator::column(int id) const
+{
+    int slot = model->slotOf(id);
+    if (slot < 0 || size_t(slot) >= columns.size())
+        return NULL;
+    return columns[slot];
+}
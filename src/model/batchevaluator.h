@@ -0,0 +1,101 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Evaluation of a scheme over columns of input values.
+ * @file batchevaluator.h
+ *
+ *
+ */
+
+#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+#include <cstddef>
+#include <vector>
+#include "schememodel.h"
+
+/**
+ * @brief The BatchEvaluator class evaluates a scheme for many input rows at once.
+ *
+ * Every Input block is bound to a column of values, every other block gets a column
+ * of results. The blocks are calculated in the order of the plan of the model, each one
+ * with a SIMD kernel running over the whole column. The instruction set of the kernels
+ * (scalar, SSE2 or AVX2) is chosen at runtime.
+ */
+class BatchEvaluator
+{
+public:
+    /**
+     * @brief The Isa enum contains a set of instruction sets the kernels can use.
+     */
+    enum Isa { Scalar, SSE2, AVX2 };
+    /**
+     * @brief BatchEvaluator is the constructor.
+     * @param model Model of the scheme to evaluate. It must not change while the evaluator is used.
+     */
+    BatchEvaluator(const SchemeModel* model);
+    /**
+     * @brief detectIsa returns the best instruction set supported by the processor.
+     * @return the instruction set.
+     */
+    static Isa detectIsa();
+    /**
+     * @brief isa returns the instruction set used by the kernels.
+     * @return the instruction set.
+     */
+    Isa isa() const;
+    /**
+     * @brief setIsa forces an instruction set, e.g. for comparing the kernels. It must be supported by the processor.
+     * @param isa Instruction set to use.
+     */
+    void setIsa(Isa isa);
+    /**
+     * @brief bindInput binds a column of values to an Input block.
+     * @param id Id of the Input block.
+     * @param column Values of the block, at least as many as rows passed to run(). The column is not copied.
+     * @return true if the block exists and is an Input block.
+     */
+    bool bindInput(int id, const double* column);
+    /**
+     * @brief run evaluates the scheme for a number of rows.
+     * @param rows Number of rows.
+     * @param err Set to DivByZero if any row divided by zero, the row then holds the IEEE result (inf or nan),
+     * NoErr otherwise.
+     * @return false if an Input block is not bound, an input port is not connected or the scheme contains a loop.
+     */
+    bool run(size_t rows, SchemeModel::EvalError* err = NULL);
+    /**
+     * @brief column returns the column of values of a block calculated by the last run.
+     * @param id Id of a block, typically of an Output block.
+     * @return the column, NULL if the block was not calculated.
+     */
+    const double* column(int id) const;
+    /**
+     * @brief calculateBlock runs the kernel of a single block over a range of rows.
+     * The columns of its inputs must already be calculated. Used by the parallel evaluator.
+     * @param slot Slot of the block.
+     * @param begin First row.
+     * @param end Row after the last one.
+     * @return true if some row divided by zero.
+     */
+    bool calculateBlock(int slot, size_t begin, size_t end);
+    /**
+     * @brief prepare checks the scheme and allocates the columns for a run.
+     * @param rows Number of rows.
+     * @param plan Filled with the slots of blocks in the order of evaluation.
+     * @return false under the same conditions as run().
+     */
+    bool prepare(size_t rows, std::vector<int>* plan);
+private:
+    const SchemeModel* model; /**< evaluated scheme.*/
+    Isa kernelIsa; /**< instruction set of the kernels.*/
+    std::vector<const double*> bound; /**< bound columns of Input blocks, indexed by slot.*/
+    std::vector<const double*> columns; /**< columns of all blocks of the last run, indexed by slot.*/
+    std::vector<std::vector<double> > storage; /**< memory of calculated columns, reused between runs.*/
+};
+
+#endif // BATCHEVALUATOR_H
@@ -0,0 +1,296 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Containers whose copies share unchanged chunks.
+ * @file chunkedstorage.h
+ *
+ *
+ */
+
+#ifndef CHUNKEDSTORAGE_H
+#define CHUNKEDSTORAGE_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+/**
+ * @brief The ChunkedVector class is a vector stored in chunks of a fixed size.
+ *
+ * A copy only copies the pointers to the chunks. A chunk shared with a copy is copied
+ * by the first change of one of its elements, so a change never copies more than one chunk.
+ * Elements are read with operator[] and changed through edit(), which is the only call copying a chunk.
+ *
+ * Sharing is not detected by the reference counts, a copy made for another thread may drop its chunks
+ * at any time. Instead, making a copy starts a new generation of both vectors and a chunk belongs
+ * to a vector only if the vector made it in its current generation. Only the thread changing the vector
+ * may copy it.
+ */
+template <typename T>
+class ChunkedVector
+{
+public:
+    /**
+     * @brief ChunkSize is the number of elements in a chunk.
+     */
+    enum { ChunkBits = 12, ChunkSize = 1 << ChunkBits };
+
+    ChunkedVector() : count(0), generation(0) {}
+    /**
+     * @brief ChunkedVector makes a copy sharing all chunks.
+     * @param other Vector to copy, its chunks become shared too.
+     */
+    ChunkedVector(const ChunkedVector& other)
+        : chunks(other.chunks), count(other.count), generation(++other.generation)
+    {
+    }
+    /**
+     * @brief operator = makes the vector a copy sharing all chunks.
+     * @param other Vector to copy, its chunks become shared too.
+     * @return this vector.
+     */
+    ChunkedVector& operator=(const ChunkedVector& other)
+    {
+        chunks = other.chunks;
+        count = other.count;
+        generation = ++other.generation;
+        return *this;
+    }
+    /**
+     * @brief size returns the number of elements.
+     * @return number of elements.
+     */
+    size_t size() const { return count; }
+    /**
+     * @brief empty checks if there are no elements.
+     * @return true if there are no elements.
+     */
+    bool empty() const { return count == 0; }
+    /**
+     * @brief operator [] reads an element.
+     * @param i Index of the element.
+     * @return the element.
+     */
+    const T& operator[](size_t i) const { return (*chunks[i >> ChunkBits].chunk)[i & (ChunkSize - 1)]; }
+    /**
+     * @brief back reads the last element.
+     * @return the last element.
+     */
+    const T& back() const { return (*this)[count - 1]; }
+    /**
+     * @brief edit gives an element for a change, its chunk is copied first if a copy shares it.
+     * @param i Index of the element.
+     * @return the element.
+     */
+    T& edit(size_t i)
+    {
+        return own(chunks[i >> ChunkBits])[i & (ChunkSize - 1)];
+    }
+    /**
+     * @brief push_back appends an element.
+     * @param value The new element.
+     */
+    void push_back(const T& value)
+    {
+        if ((count & (ChunkSize - 1)) == 0) {
+            Entry entry = { std::make_shared<Chunk>(), generation };
+            entry.chunk->reserve(ChunkSize);
+            chunks.push_back(entry);
+        }
+        own(chunks.back()).push_back(value);
+        count++;
+    }
+    /**
+     * @brief pop_back removes the last element.
+     */
+    void pop_back()
+    {
+        count--;
+        if ((count & (ChunkSize - 1)) == 0) {
+            chunks.pop_back();
+            return;
+        }
+        own(chunks.back()).pop_back();
+    }
+    /**
+     * @brief truncate removes elements from the end.
+     * @param size New number of elements, not more than the current one.
+     */
+    void truncate(size_t size)
+    {
+        if (size >= count)
+            return;
+        // Whole chunks go at once, only the new last chunk is cut
+        count = size;
+        chunks.resize((count + ChunkSize - 1) >> ChunkBits);
+        size_t tail = count & (ChunkSize - 1);
+        if (tail) {
+            Chunk& chunk = own(chunks.back());
+            chunk.erase(chunk.begin() + tail, chunk.end());
+        }
+    }
+    /**
+     * @brief clear removes all elements.
+     */
+    void clear()
+    {
+        chunks.clear();
+        count = 0;
+    }
+private:
+    typedef std::vector<T> Chunk;
+    /**
+     * @brief The Entry struct is a chunk together with the generation which made it.
+     */
+    struct Entry {
+        std::shared_ptr<Chunk> chunk; /**< elements, possibly shared with copies.*/
+        unsigned long long generation; /**< generation of the vector which made the chunk.*/
+    };
+
+    std::vector<Entry> chunks; /**< chunks of the elements.*/
+    size_t count; /**< number of elements.*/
+    mutable unsigned long long generation; /**< current generation, it grows with every copy.*/
+
+    Chunk& own(Entry& entry)
+    {
+        // A chunk from an older generation may be shared with a copy
+        if (entry.generation != generation) {
+            entry.chunk = std::make_shared<Chunk>(*entry.chunk);
+            entry.generation = generation;
+        }
+        return *entry.chunk;
+    }
+};
+
+/**
+ * @brief The ChunkedMap class maps integer keys to integer values in shards shared between copies.
+ *
+ * Keys are spread into a fixed number of hash tables by their lowest bits. A copy only copies
+ * the pointers to the tables, a change copies at most the one table it changes. Shared tables
+ * are recognized by generations like the chunks of ChunkedVector.
+ */
+class ChunkedMap
+{
+public:
+    /**
+     * @brief ShardCount is the number of hash tables.
+     */
+    enum { ShardCount = 1024 };
+
+    ChunkedMap() : shards(ShardCount), count(0), generation(0) {}
+    /**
+     * @brief ChunkedMap makes a copy sharing all tables.
+     * @param other Map to copy, its tables become shared too.
+     */
+    ChunkedMap(const ChunkedMap& other)
+        : shards(other.shards), count(other.count), generation(++other.generation)
+    {
+    }
+    /**
+     * @brief operator = makes the map a copy sharing all tables.
+     * @param other Map to copy, its tables become shared too.
+     * @return this map.
+     */
+    ChunkedMap& operator=(const ChunkedMap& other)
+    {
+        shards = other.shards;
+        count = other.count;
+        generation = ++other.generation;
+        return *this;
+    }
+    /**
+     * @brief size returns the number of keys.
+     * @return number of keys.
+     */
+    size_t size() const { return count; }
+    /**
+     * @brief contains checks if a key is in the map.
+     * @param key The key.
+     * @return true if the key is in the map.
+     */
+    bool contains(int key) const
+    {
+        const Shard* shard = shards[shardOf(key)].shard.get();
+        return shard && shard->count(key);
+    }
+    /**
+     * @brief value returns the value of a key.
+     * @param key The key.
+     * @param defaultValue Value returned if the key is not in the map.
+     * @return value of the key.
+     */
+    int value(int key, int defaultValue) const
+    {
+        const Shard* shard = shards[shardOf(key)].shard.get();
+        if (!shard)
+            return defaultValue;
+        Shard::const_iterator it = shard->find(key);
+        return it == shard->end() ? defaultValue : it->second;
+    }
+    /**
+     * @brief insert sets the value of a key.
+     * @param key The key.
+     * @param value The value.
+     */
+    void insert(int key, int value)
+    {
+        Shard& shard = edit(key);
+        size_t before = shard.size();
+        shard[key] = value;
+        count += shard.size() - before;
+    }
+    /**
+     * @brief erase removes a key.
+     * @param key The key.
+     */
+    void erase(int key)
+    {
+        if (contains(key)) {
+            edit(key).erase(key);
+            count--;
+        }
+    }
+    /**
+     * @brief clear removes all keys.
+     */
+    void clear()
+    {
+        shards.assign(ShardCount, Entry());
+        count = 0;
+    }
+private:
+    typedef std::unordered_map<int, int> Shard;
+    /**
+     * @brief The Entry struct is a hash table together with the generation which made it.
+     */
+    struct Entry {
+        std::shared_ptr<Shard> shard; /**< hash table, NULL while empty, possibly shared with copies.*/
+        unsigned long long generation; /**< generation of the map which made the table.*/
+
+        Entry() : generation(0) {}
+    };
+
+    std::vector<Entry> shards; /**< hash tables.*/
+    size_t count; /**< number of keys.*/
+    mutable unsigned long long generation; /**< current generation, it grows with every copy.*/
+
+    static size_t shardOf(int key) { return size_t(unsigned(key) & (ShardCount - 1)); }
+
+    Shard& edit(int key)
+    {
+        Entry& entry = shards[shardOf(key)];
+        if (!entry.shard)
+            entry.shard = std::make_shared<Shard>();
+        else if (entry.generation != generation)
+            entry.shard = std::make_shared<Shard>(*entry.shard);
+        entry.generation = generation;
+        return *entry.shard;
+    }
+};
+
+#endif // CHUNKEDSTORAGE_H
@@ -0,0 +1,13 @@
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/schememodel.cpp \
+    $$PWD/batchevaluator.cpp \
+    $$PWD/parallelevaluator.cpp
+
+HEADERS += \
+    $$PWD/schememodel.h \
+    $$PWD/chunkedstorage.h \
+    $$PWD/batchevaluator.h \
+    $$PWD/parallelevaluator.h
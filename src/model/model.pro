@@ -0,0 +1,8 @@
+TEMPLATE = lib
+TARGET = schememodel
+
+CONFIG += staticlib c++14
+CONFIG -= qt
+CONFIG += thread
+
+include(model.pri)
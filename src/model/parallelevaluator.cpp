@@ -0,0 +1,261 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the multithreaded evaluation.
+ * @file parallelevaluator.cpp
+ *
+ *
+ */
+
+#include "parallelevaluator.h"
+
+ParallelEvaluator::ParallelEvaluator(const SchemeModel* model, int threadCount) : batch(model)
+{
+    this->model = model;
+    cutoff = 4096;
+    runRows = 0;
+    pendingSize = 0;
+    remaining = 0;
+    queued = 0;
+    sleepers = 0;
+    divByZero = false;
+    generation = 0;
+    finished = 0;
+    stopping = false;
+
+    if (threadCount <= 0)
+        threadCount = int(std::thread::hardware_concurrency());
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    for (int i = 0; i < threadCount; i++)
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (int i = 1; i < threadCount; i++)
+        threads.push_back(std::thread(&ParallelEvaluator::threadLoop, this, i));
+}
+
+ParallelEvaluator::~ParallelEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> guard(runLock);
+        stopping = true;
+    }
+    runStart.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+}
+
+bool ParallelEvaluator::bindInput(int id, const double* column)
+{
+    return batch.bindInput(id, column);
+}
+
+void ParallelEvaluator::setCutoff(size_t rows)
+{
+    cutoff = rows;
+}
+
+int ParallelEvaluator::threadCount() const
+{
+    return int(workers.size());
+}
+
+const double* ParallelEvaluator::column(int id) const
+{
+    return batch.column(id);
+}
+
+bool ParallelEvaluator::run(size_t rows, SchemeModel::EvalError* err)
+{
+    if (err)
+        *err = SchemeModel::NoErr;
+    std::vector<int> plan;
+    if (!batch.prepare(rows, &plan))
+        return false;
+
+    // Not worth waking the threads, walk the plan
+    if (threads.empty() || rows < cutoff) {
+        bool zero = false;
+        for (size_t i = 0; i < plan.size(); i++)
+            zero |= batch.calculateBlock(plan[i], 0, rows);
+        if (zero && err)
+            *err = SchemeModel::DivByZero;
+        return true;
+    }
+
+    size_t slots = size_t(model->slotCount());
+    if (pendingSize < slots) {
+        pending.reset(new std::atomic<int>[slots]);
+        pendingSize = slots;
+    }
+
+    // Count the inputs of every block, blocks without inputs are ready right away
+    int next = 0;
+    int initial = 0;
+    for (size_t i = 0; i < plan.size(); i++) {
+        int slot = plan[i];
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        int degree = 0;
+        for (int port = 0; port < SchemeModel::MaxInPorts; port++) {
+            if (block.inEdges[port] >= 0)
+                degree++;
+        }
+        pending[slot].store(degree, std::memory_order_relaxed);
+        if (degree == 0) {
+            workers[next]->ready.push_back(slot);
+            next = (next + 1) % int(workers.size());
+            initial++;
+        }
+    }
+    runRows = rows;
+    queued = initial;
+    remaining = int(plan.size());
+    divByZero = false;
+
+    {
+        std::lock_guard<std::mutex> guard(runLock);
+        finished = 0;
+        generation++;
+    }
+    runStart.notify_all();
+
+    work(0);
+
+    {
+        std::unique_lock<std::mutex> guard(runLock);
+        runDone.wait(guard, [this] { return finished == int(threads.size()); });
+    }
+
+    if (divByZero && err)
+        *err = SchemeModel::DivByZero;
+    return true;
+}
+
+void ParallelEvaluator::threadLoop(int index)
+{
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> guard(runLock);
+            runStart.wait(guard, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        work(index);
+
+        {
+            std::lock_guard<std::mutex> guard(runLock);
+            finished++;
+        }
+        runDone.notify_one();
+    }
+}
+
+void ParallelEvaluator::work(int index)
+{
+    int slot;
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (takeTask(index, &slot)) {
+            execute(index, slot);
+            continue;
+        }
+        // The counters are sequentially consistent, so either the waker sees this sleeper
+        // or this thread sees the queued block or the end of the run
+        std::unique_lock<std::mutex> guard(idleLock);
+        sleepers++;
+        taskReady.wait(guard, [this] { return queued.load() > 0 || remaining.load() == 0; });
+        sleepers--;
+    }
+}
+
+void ParallelEvaluator::wakeIdle()
+{
+    if (sleepers.load() == 0)
+        return;
+    // Taking the lock makes sure a thread that has just checked the counters is already waiting
+    { std::lock_guard<std::mutex> guard(idleLock); }
+    taskReady.notify_all();
+}
+
+bool ParallelEvaluator::takeTask(int index, int* slot)
+{
+    // Own queue first, newest block has its inputs still in the cache
+    {
+        Worker* own = workers[index].get();
+        std::lock_guard<std::mutex> guard(own->lock);
+        if (!own->ready.empty()) {
+            *slot = own->ready.back();
+            own->ready.pop_back();
+            queued--;
+            return true;
+        }
+    }
+    // Steal the oldest block of another thread
+    int count = int(workers.size());
+    for (int i = 1; i < count; i++) {
+        Worker* victim = workers[(index + i) % count].get();
+        std::lock_guard<std::mutex> guard(victim->lock);
+        if (!victim->ready.empty()) {
+            *slot = victim->ready.front();
+            victim->ready.pop_front();
+            queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ParallelEvaluator::isCheap(int slot) const
+{
+    // Inputs and outputs only pass a column along, there is nothing to calculate
+    SchemeModel::BlockType type = model->blockAt(slot).type;
+    return type == SchemeModel::Input || type == SchemeModel::Output;
+}
+
+void ParallelEvaluator::execute(int index, int slot)
+{
+    Worker* own = workers[index].get();
+    std::vector<int>& inlined = own->inlined;
+    inlined.push_back(slot);
+
+    while (!inlined.empty()) {
+        slot = inlined.back();
+        inlined.pop_back();
+        if (batch.calculateBlock(slot, 0, runRows))
+            divByZero = true;
+
+        // Cheap successors and one expensive successor stay with this thread, the rest can be stolen
+        bool kept = false;
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        for (size_t i = 0; i < block.outEdges.size(); i++) {
+            int nextSlot = model->edgeAt(block.outEdges[i]).to;
+            if (pending[nextSlot].fetch_sub(1, std::memory_order_acq_rel) != 1)
+                continue;
+            if (isCheap(nextSlot)) {
+                inlined.push_back(nextSlot);
+            }
+            else if (!kept) {
+                inlined.push_back(nextSlot);
+                kept = true;
+            }
+            else {
+                {
+                    std::lock_guard<std::mutex> guard(own->lock);
+                    own->ready.push_back(nextSlot);
+                }
+                queued++;
+                wakeIdle();
+            }
+        }
+
+        // The last block ends the run for the sleeping threads too
+        if (remaining.fetch_sub(1) == 1)
+            wakeIdle();
+    }
+}
@@ -0,0 +1,126 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Multithreaded evaluation of a scheme over columns of input values.
+ * @file parallelevaluator.h
+ *
+ *
+ */
+
+#ifndef PARALLELEVALUATOR_H
+#define PARALLELEVALUATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "batchevaluator.h"
+
+/**
+ * @brief The ParallelEvaluator class runs the blocks of a batch evaluation concurrently.
+ *
+ * Each block keeps an atomic counter of inputs that are not calculated yet. A block becomes
+ * ready when its counter hits zero and is pushed to the queue of the thread that finished
+ * its last input. Idle threads steal the oldest ready blocks from the queues of other threads,
+ * so independent branches of the scheme are calculated in parallel. A thread finding nothing
+ * to steal sleeps until a block is queued or the run ends.
+ *
+ * Inputs and outputs only pass columns along and are never queued, the thread that made them
+ * ready handles them right away. A run with fewer rows than the cutoff is too small to pay for
+ * the dispatching and does not wake the threads at all.
+ */
+class ParallelEvaluator
+{
+public:
+    /**
+     * @brief ParallelEvaluator is the constructor.
+     * @param model Model of the scheme to evaluate. It must not change while the evaluator is used.
+     * @param threads Number of threads including the calling one, 0 to use all cores.
+     */
+    ParallelEvaluator(const SchemeModel* model, int threads = 0);
+    /**
+     * @brief ~ParallelEvaluator stops the threads.
+     */
+    ~ParallelEvaluator();
+    /**
+     * @brief bindInput binds a column of values to an Input block, see BatchEvaluator::bindInput().
+     * @param id Id of the Input block.
+     * @param column Values of the block.
+     * @return true if the block exists and is an Input block.
+     */
+    bool bindInput(int id, const double* column);
+    /**
+     * @brief setCutoff sets the number of rows below which a run is not worth dispatching to other threads.
+     * Every block of a run has the same number of rows, so a smaller run is calculated by the calling thread alone.
+     * @param rows Number of rows.
+     */
+    void setCutoff(size_t rows);
+    /**
+     * @brief threadCount returns the number of threads including the calling one.
+     * @return number of threads.
+     */
+    int threadCount() const;
+    /**
+     * @brief run evaluates the scheme for a number of rows, see BatchEvaluator::run().
+     * @param rows Number of rows.
+     * @param err Set to DivByZero if any row divided by zero, NoErr otherwise.
+     * @return false if an Input block is not bound, an input port is not connected or the scheme contains a loop.
+     */
+    bool run(size_t rows, SchemeModel::EvalError* err = NULL);
+    /**
+     * @brief column returns the column of values of a block calculated by the last run.
+     * @param id Id of a block.
+     * @return the column, NULL if the block was not calculated.
+     */
+    const double* column(int id) const;
+private:
+    /**
+     * @brief The Worker struct is a queue of ready blocks owned by one thread.
+     * The owner takes the newest blocks, thieves take the oldest ones.
+     */
+    struct Worker {
+        std::mutex lock; /**< guards the queue.*/
+        std::deque<int> ready; /**< blocks ready to be calculated.*/
+        std::vector<int> inlined; /**< blocks this thread calculates without queueing, never stolen.*/
+    };
+
+    const SchemeModel* model; /**< evaluated scheme.*/
+    BatchEvaluator batch; /**< columns and kernels.*/
+    size_t cutoff; /**< smallest number of rows worth waking the threads.*/
+    size_t runRows; /**< number of rows of the current run.*/
+
+    std::vector<std::unique_ptr<Worker> > workers; /**< queues, the calling thread is the worker 0.*/
+    std::vector<std::thread> threads; /**< background threads, workers 1 and up.*/
+    std::unique_ptr<std::atomic<int>[]> pending; /**< inputs not calculated yet, indexed by slot.*/
+    size_t pendingSize; /**< size of the pending array.*/
+    std::atomic<int> remaining; /**< blocks not calculated yet in the current run.*/
+    std::atomic<int> queued; /**< blocks in the queues of all threads.*/
+    std::atomic<int> sleepers; /**< threads waiting on taskReady.*/
+    std::atomic<bool> divByZero; /**< whether some row divided by zero in the current run.*/
+
+    std::mutex idleLock; /**< paired with taskReady.*/
+    std::condition_variable taskReady; /**< wakes idle threads when a block is queued or the run ends.*/
+
+    std::mutex runLock; /**< guards the fields below.*/
+    std::condition_variable runStart; /**< wakes the threads for a run.*/
+    std::condition_variable runDone; /**< wakes the caller when the threads are finished.*/
+    unsigned generation; /**< number of the current run.*/
+    int finished; /**< threads finished with the current run.*/
+    bool stopping; /**< whether the threads should exit.*/
+
+    void threadLoop(int index);
+    void work(int index);
+    void execute(int index, int slot);
+    bool takeTask(int index, int* slot);
+    void wakeIdle();
+    bool isCheap(int slot) const;
+};
+
+#endif // PARALLELEVALUATOR_H
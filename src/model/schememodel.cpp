@@ -0,0 +1,731 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief A representation of a headless scheme model.
+ * @file schememodel.cpp
+ *
+ *
+ */
+
+#include "schememodel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+SchemeModel::Data::Data()
+{
+    numberOfEdges = 0;
+    topoHoles = 0;
+    revision = 0;
+}
+
+SchemeModel::SlotValue::SlotValue()
+{
+    value = 0;
+    valueSet = false;
+    calculated = false;
+}
+
+SchemeModel::SchemeModel()
+    : visitEpoch(0), listener(NULL)
+{
+}
+
+SchemeModel::SchemeModel(const SchemeModel& other)
+    : d(other.d), visitEpoch(0), listener(NULL)
+{
+}
+
+SchemeModel& SchemeModel::operator=(const SchemeModel& other)
+{
+    d = other.d;
+    values.clear();
+    visitMark.clear();
+    coneDegree.clear();
+    visitEpoch = 0;
+    return *this;
+}
+
+void SchemeModel::setListener(Listener* listener)
+{
+    this->listener = listener;
+}
+
+const SchemeModel::SlotValue& SchemeModel::valueAt(int slot) const
+{
+    static const SlotValue none;
+    if (size_t(slot) >= values.size())
+        return none;
+    return values[slot];
+}
+
+SchemeModel::SlotValue& SchemeModel::editValue(int slot)
+{
+    // A snapshot starts without values, they are added as blocks get them
+    if (size_t(slot) >= values.size())
+        values.resize(d.blocks.size());
+    return values[slot];
+}
+
+void SchemeModel::prepareTraversal()
+{
+    if (visitMark.size() < d.blocks.size()) {
+        visitMark.resize(d.blocks.size(), 0);
+        coneDegree.resize(d.blocks.size(), 0);
+    }
+}
+
+int SchemeModel::inPortCount(BlockType type)
+{
+    switch (type) {
+    case Pow2:
+    case Sqrt:
+    case Output:
+        return 1;
+    case Input:
+        return 0;
+    default:
+        return 2;
+    }
+}
+
+int SchemeModel::outPortCount(BlockType type)
+{
+    if (type == Output)
+        return 0;
+    return 1;
+}
+
+SchemeModel::EvalError SchemeModel::apply(BlockType type, double input1, double input2, double* result)
+{
+    switch (type) {
+    case Add:
+        *result = input1 + input2;
+        break;
+    case Sub:
+        *result = input1 - input2;
+        break;
+    case Mul:
+        *result = input1 * input2;
+        break;
+    case Div:
+        if (input2 == 0)
+            return DivByZero;
+        *result = input1 / input2;
+        break;
+    case Pow2:
+        *result = input1 * input1;
+        break;
+    case PowX:
+        *result = std::pow(input1, input2);
+        break;
+    case Sqrt:
+        *result = std::sqrt(input1);
+        break;
+    case Input:
+        break;
+    case Output:
+        *result = input1;
+        break;
+    }
+    return NoErr;
+}
+
+bool SchemeModel::addBlock(BlockType type, int id, int x, int y)
+{
+    if (id < 0 || d.slotById.contains(id))
+        return false;
+
+    int slot;
+    if (d.freeBlocks.empty()) {
+        slot = int(d.blocks.size());
+        d.blocks.push_back(BlockRecord());
+    }
+    else {
+        slot = d.freeBlocks.back();
+        d.freeBlocks.pop_back();
+    }
+
+    BlockRecord& block = d.blocks.edit(slot);
+    block.id = id;
+    block.type = type;
+    block.x = x;
+    block.y = y;
+    for (int i = 0; i < MaxInPorts; i++)
+        block.inEdges[i] = -1;
+    block.inputSet = false;
+    block.inputValue = 0;
+    block.outEdges.clear();
+
+    // A block without edges can go anywhere, the end of the order is as good as any
+    block.ord = int(d.topoOrder.size());
+    d.topoOrder.push_back(slot);
+    if (size_t(slot) < values.size())
+        values[slot] = SlotValue();
+
+    d.slotById.insert(id, slot);
+    d.revision++;
+    if (listener)
+        listener->blockAdded(block);
+    return true;
+}
+
+void SchemeModel::removeBlock(int id)
+{
+    int slot = slotOf(id);
+    if (slot < 0)
+        return;
+
+    BlockRecord& block = d.blocks.edit(slot);
+    for (int i = 0; i < MaxInPorts; i++) {
+        if (block.inEdges[i] >= 0)
+            removeEdge(block.inEdges[i]);
+    }
+    while (!block.outEdges.empty())
+        removeEdge(block.outEdges.back());
+
+    block.id = -1;
+    d.slotById.erase(id);
+    d.freeBlocks.push_back(slot);
+
+    d.topoOrder.edit(block.ord) = -1;
+    d.topoHoles++;
+    d.revision++;
+    if (d.topoHoles > 1024 && d.topoHoles > blockCount())
+        compactOrder();
+    if (listener)
+        listener->blockRemoved(id);
+}
+
+void SchemeModel::moveBlock(int id, int x, int y)
+{
+    int slot = slotOf(id);
+    if (slot < 0)
+        return;
+    BlockRecord& block = d.blocks.edit(slot);
+    block.x = x;
+    block.y = y;
+    d.revision++;
+    if (listener)
+        listener->blockMoved(id);
+}
+
+bool SchemeModel::connect(int fromId, int toId, int toPort, ConnectError* error)
+{
+    ConnectError dummy;
+    if (!error)
+        error = &dummy;
+    *error = NoSuchPort;
+    int from = slotOf(fromId);
+    int to = slotOf(toId);
+    if (from < 0 || to < 0 || from == to)
+        return false;
+    if (outPortCount(d.blocks[from].type) == 0)
+        return false;
+    if (toPort < 0 || toPort >= inPortCount(d.blocks[to].type))
+        return false;
+    *error = PortTaken;
+    if (d.blocks[to].inEdges[toPort] >= 0)
+        return false;
+    *error = FormsLoop;
+    if (!reorder(from, to))
+        return false;
+    *error = ConnectOk;
+
+    int edge;
+    if (d.freeEdges.empty()) {
+        edge = int(d.edges.size());
+        d.edges.push_back(Edge());
+    }
+    else {
+        edge = d.freeEdges.back();
+        d.freeEdges.pop_back();
+    }
+    Edge& e = d.edges.edit(edge);
+    e.from = from;
+    e.to = to;
+    e.toPort = toPort;
+
+    d.blocks.edit(from).outEdges.push_back(edge);
+    d.blocks.edit(to).inEdges[toPort] = edge;
+    d.numberOfEdges++;
+    d.revision++;
+    if (listener)
+        listener->connected(fromId, toId, toPort);
+    return true;
+}
+
+void SchemeModel::disconnect(int toId, int toPort)
+{
+    int to = slotOf(toId);
+    if (to < 0 || toPort < 0 || toPort >= MaxInPorts)
+        return;
+    if (d.blocks[to].inEdges[toPort] < 0)
+        return;
+    removeEdge(d.blocks[to].inEdges[toPort]);
+    if (listener)
+        listener->disconnected(toId, toPort);
+}
+
+void SchemeModel::removeEdge(int edge)
+{
+    Edge& e = d.edges.edit(edge);
+    std::vector<int>& outEdges = d.blocks.edit(e.from).outEdges;
+    for (std::vector<int>::iterator it = outEdges.begin(); it != outEdges.end(); ++it) {
+        if (*it == edge) {
+            // Keep the order, the save file lists connections in order of creation
+            outEdges.erase(it);
+            break;
+        }
+    }
+    d.blocks.edit(e.to).inEdges[e.toPort] = -1;
+    e.from = -1;
+    d.freeEdges.push_back(edge);
+    d.numberOfEdges--;
+    d.revision++;
+}
+
+void SchemeModel::clear()
+{
+    // Chunks shared with a snapshot stay with it, nothing is copied
+    unsigned long long revision = d.revision + 1;
+    d = Data();
+    d.revision = revision;
+    values.clear();
+    visitMark.clear();
+    coneDegree.clear();
+    if (listener)
+        listener->cleared();
+}
+
+bool SchemeModel::reorder(int from, int to)
+{
+    int lowerBound = d.blocks[to].ord;
+    int upperBound = d.blocks[from].ord;
+    if (upperBound < lowerBound)
+        return true;
+
+    // Blocks reachable from the target that are not after the source in the order.
+    // Reaching the source itself means the edge would close a loop.
+    prepareTraversal();
+    unsigned forwardMark = ++visitEpoch;
+    std::vector<int> forward;
+    std::vector<int> stack(1, to);
+    visitMark[to] = forwardMark;
+    while (!stack.empty()) {
+        int slot = stack.back();
+        stack.pop_back();
+        forward.push_back(slot);
+        const std::vector<int>& outEdges = d.blocks[slot].outEdges;
+        for (size_t i = 0; i < outEdges.size(); i++) {
+            int next = d.edges[outEdges[i]].to;
+            if (next == from)
+                return false;
+            if (visitMark[next] != forwardMark && d.blocks[next].ord < upperBound) {
+                visitMark[next] = forwardMark;
+                stack.push_back(next);
+            }
+        }
+    }
+
+    // Blocks the source depends on that are not before the target in the order
+    unsigned backwardMark = ++visitEpoch;
+    std::vector<int> backward;
+    stack.assign(1, from);
+    visitMark[from] = backwardMark;
+    while (!stack.empty()) {
+        int slot = stack.back();
+        stack.pop_back();
+        backward.push_back(slot);
+        for (int port = 0; port < MaxInPorts; port++) {
+            int edge = d.blocks[slot].inEdges[port];
+            if (edge < 0)
+                continue;
+            int prev = d.edges[edge].from;
+            if (visitMark[prev] != backwardMark && d.blocks[prev].ord > lowerBound) {
+                visitMark[prev] = backwardMark;
+                stack.push_back(prev);
+            }
+        }
+    }
+
+    // Reuse the positions of both sets, backward blocks take the lower ones
+    const ChunkedVector<BlockRecord>& records = d.blocks;
+    auto byOrder = [&records] (int a, int b) { return records[a].ord < records[b].ord; };
+    std::sort(forward.begin(), forward.end(), byOrder);
+    std::sort(backward.begin(), backward.end(), byOrder);
+
+    std::vector<int> positions;
+    positions.reserve(forward.size() + backward.size());
+    for (size_t i = 0; i < backward.size(); i++)
+        positions.push_back(d.blocks[backward[i]].ord);
+    for (size_t i = 0; i < forward.size(); i++)
+        positions.push_back(d.blocks[forward[i]].ord);
+    std::sort(positions.begin(), positions.end());
+
+    size_t next = 0;
+    for (size_t i = 0; i < backward.size(); i++, next++) {
+        d.blocks.edit(backward[i]).ord = positions[next];
+        d.topoOrder.edit(positions[next]) = backward[i];
+    }
+    for (size_t i = 0; i < forward.size(); i++, next++) {
+        d.blocks.edit(forward[i]).ord = positions[next];
+        d.topoOrder.edit(positions[next]) = forward[i];
+    }
+    return true;
+}
+
+void SchemeModel::compactOrder()
+{
+    size_t used = 0;
+    for (size_t i = 0; i < d.topoOrder.size(); i++) {
+        int slot = d.topoOrder[i];
+        if (slot < 0)
+            continue;
+        d.blocks.edit(slot).ord = int(used);
+        d.topoOrder.edit(used++) = slot;
+    }
+    d.topoOrder.truncate(used);
+    d.topoHoles = 0;
+}
+
+unsigned long long SchemeModel::revision() const
+{
+    return d.revision;
+}
+
+bool SchemeModel::contains(int id) const
+{
+    return d.slotById.contains(id);
+}
+
+bool SchemeModel::isInputConnected(int id, int port) const
+{
+    int slot = slotOf(id);
+    if (slot < 0 || port < 0 || port >= MaxInPorts)
+        return false;
+    return d.blocks[slot].inEdges[port] >= 0;
+}
+
+int SchemeModel::blockCount() const
+{
+    return int(d.slotById.size());
+}
+
+int SchemeModel::edgeCount() const
+{
+    return d.numberOfEdges;
+}
+
+int SchemeModel::slotOf(int id) const
+{
+    return d.slotById.value(id, -1);
+}
+
+int SchemeModel::slotCount() const
+{
+    return int(d.blocks.size());
+}
+
+const SchemeModel::BlockRecord& SchemeModel::blockAt(int slot) const
+{
+    return d.blocks[slot];
+}
+
+int SchemeModel::edgeSlotCount() const
+{
+    return int(d.edges.size());
+}
+
+const SchemeModel::Edge& SchemeModel::edgeAt(int edge) const
+{
+    return d.edges[edge];
+}
+
+void SchemeModel::setInputValue(int id, double value)
+{
+    int slot = slotOf(id);
+    if (slot < 0)
+        return;
+    SlotValue& slotValue = editValue(slot);
+    slotValue.value = value;
+    slotValue.valueSet = true;
+    // The value is a part of the scheme, a save of a snapshot keeps it
+    BlockRecord& block = d.blocks.edit(slot);
+    block.inputSet = true;
+    block.inputValue = value;
+    d.revision++;
+    if (listener)
+        listener->inputValueChanged(id);
+}
+
+bool SchemeModel::hasValue(int id) const
+{
+    int slot = slotOf(id);
+    return slot >= 0 && valueAt(slot).valueSet;
+}
+
+double SchemeModel::value(int id) const
+{
+    int slot = slotOf(id);
+    if (slot < 0 || !valueAt(slot).valueSet)
+        return 0;
+    return valueAt(slot).value;
+}
+
+bool SchemeModel::inputHasValue(int id, int port) const
+{
+    int slot = slotOf(id);
+    if (slot < 0 || port < 0 || port >= MaxInPorts)
+        return false;
+    int edge = d.blocks[slot].inEdges[port];
+    return edge >= 0 && valueAt(d.edges[edge].from).calculated;
+}
+
+double SchemeModel::inputValue(int id, int port) const
+{
+    int slot = slotOf(id);
+    if (slot < 0 || port < 0 || port >= MaxInPorts)
+        return 0;
+    return slotInputValue(slot, port);
+}
+
+double SchemeModel::slotInputValue(int slot, int port) const
+{
+    int edge = d.blocks[slot].inEdges[port];
+    if (edge < 0)
+        return 0;
+    const SlotValue& source = valueAt(d.edges[edge].from);
+    if (!source.calculated)
+        return 0;
+    return source.value;
+}
+
+bool SchemeModel::allInputPortsConnected() const
+{
+    for (size_t slot = 0; slot < d.blocks.size(); slot++) {
+        const BlockRecord& block = d.blocks[slot];
+        if (block.id < 0)
+            continue;
+        for (int i = 0; i < inPortCount(block.type); i++) {
+            if (block.inEdges[i] < 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SchemeModel::allInputBlocksInitialized() const
+{
+    for (size_t slot = 0; slot < d.blocks.size(); slot++) {
+        const BlockRecord& block = d.blocks[slot];
+        if (block.id >= 0 && block.type == Input && !valueAt(int(slot)).valueSet)
+            return false;
+    }
+    return true;
+}
+
+bool SchemeModel::findCycle(std::vector<int>* cycle) const
+{
+    enum { White, Grey, Black };
+    std::vector<char> colour(d.blocks.size(), White);
+    // Path of the search, each entry is a slot and the index of its next edge to follow
+    std::vector<std::pair<int, size_t> > path;
+
+    for (size_t root = 0; root < d.blocks.size(); root++) {
+        if (d.blocks[root].id < 0 || colour[root] != White)
+            continue;
+
+        colour[root] = Grey;
+        path.push_back(std::make_pair(int(root), size_t(0)));
+        while (!path.empty()) {
+            int slot = path.back().first;
+            size_t& nextEdge = path.back().second;
+            const std::vector<int>& outEdges = d.blocks[slot].outEdges;
+            if (nextEdge == outEdges.size()) {
+                colour[slot] = Black;
+                path.pop_back();
+                continue;
+            }
+
+            int next = d.edges[outEdges[nextEdge++]].to;
+            if (colour[next] == White) {
+                colour[next] = Grey;
+                path.push_back(std::make_pair(next, size_t(0)));
+            }
+            else if (colour[next] == Grey) {
+                // The block is on the path, the loop is the part of the path from it
+                if (cycle) {
+                    cycle->clear();
+                    size_t i = path.size();
+                    while (path[i-1].first != next)
+                        i--;
+                    for (i--; i < path.size(); i++)
+                        cycle->push_back(d.blocks[path[i].first].id);
+                }
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool SchemeModel::buildPlan(std::vector<int>* plan) const
+{
+    plan->clear();
+    plan->reserve(d.slotById.size());
+    for (size_t i = 0; i < d.topoOrder.size(); i++) {
+        if (d.topoOrder[i] >= 0)
+            plan->push_back(d.topoOrder[i]);
+    }
+    return plan->size() == d.slotById.size();
+}
+
+SchemeModel::EvalError SchemeModel::evaluateSlot(int slot)
+{
+    const BlockRecord& block = d.blocks[slot];
+    for (int i = 0; i < inPortCount(block.type); i++) {
+        if (block.inEdges[i] < 0)
+            return NoErr;
+    }
+
+    if (block.type == Input) {
+        editValue(slot).calculated = true;
+        return NoErr;
+    }
+
+    double result;
+    EvalError err = apply(block.type, slotInputValue(slot, 0), slotInputValue(slot, 1), &result);
+    if (err)
+        return err;
+    SlotValue& slotValue = editValue(slot);
+    slotValue.value = result;
+    slotValue.valueSet = true;
+    slotValue.calculated = true;
+    return NoErr;
+}
+
+SchemeModel::EvalError SchemeModel::evaluateAll()
+{
+    std::vector<int> plan;
+    buildPlan(&plan);
+    for (size_t i = 0; i < plan.size(); i++) {
+        EvalError err = evaluateSlot(plan[i]);
+        if (err)
+            return err;
+    }
+    return NoErr;
+}
+
+SchemeModel::EvalError SchemeModel::recalculateFrom(int id, std::vector<int>* changed)
+{
+    int start = slotOf(id);
+    if (start < 0)
+        return NoErr;
+
+    // Collect the downstream cone of the block
+    prepareTraversal();
+    visitEpoch++;
+    std::vector<int> cone(1, start);
+    visitMark[start] = visitEpoch;
+    for (size_t i = 0; i < cone.size(); i++) {
+        const BlockRecord& block = d.blocks[cone[i]];
+        for (size_t j = 0; j < block.outEdges.size(); j++) {
+            int next = d.edges[block.outEdges[j]].to;
+            if (visitMark[next] != visitEpoch) {
+                visitMark[next] = visitEpoch;
+                cone.push_back(next);
+            }
+        }
+    }
+
+    // Kahn's algorithm limited to the cone, only edges inside it count
+    for (size_t i = 0; i < cone.size(); i++)
+        coneDegree[cone[i]] = 0;
+    for (size_t i = 0; i < cone.size(); i++) {
+        const BlockRecord& block = d.blocks[cone[i]];
+        for (size_t j = 0; j < block.outEdges.size(); j++)
+            coneDegree[d.edges[block.outEdges[j]].to]++;
+    }
+    std::vector<int> order;
+    order.reserve(cone.size());
+    if (coneDegree[start] == 0)
+        order.push_back(start);
+    for (size_t i = 0; i < order.size(); i++) {
+        const BlockRecord& block = d.blocks[order[i]];
+        for (size_t j = 0; j < block.outEdges.size(); j++) {
+            int next = d.edges[block.outEdges[j]].to;
+            if (--coneDegree[next] == 0)
+                order.push_back(next);
+        }
+    }
+
+    return recalculate(order, changed);
+}
+
+SchemeModel::EvalError SchemeModel::recalculateAll(std::vector<int>* changed)
+{
+    std::vector<int> plan;
+    buildPlan(&plan);
+    return recalculate(plan, changed);
+}
+
+SchemeModel::EvalError SchemeModel::recalculate(const std::vector<int>& order, std::vector<int>* changed)
+{
+    EvalError firstErr = NoErr;
+    if (changed)
+        changed->clear();
+
+    for (size_t i = 0; i < order.size(); i++) {
+        int slot = order[i];
+        const BlockRecord& block = d.blocks[slot];
+        SlotValue& slotValue = editValue(slot);
+        if (changed)
+            changed->push_back(slot);
+
+        if (block.type == Input) {
+            slotValue.calculated = slotValue.valueSet;
+            continue;
+        }
+
+        // Calculate only from fresh values, never from a value of a previous run
+        bool ready = true;
+        for (int port = 0; port < inPortCount(block.type); port++) {
+            int edge = block.inEdges[port];
+            if (edge < 0 || !valueAt(d.edges[edge].from).calculated)
+                ready = false;
+        }
+
+        double result;
+        EvalError err = NoErr;
+        if (ready)
+            err = apply(block.type, slotInputValue(slot, 0), slotInputValue(slot, 1), &result);
+        if (ready && !err) {
+            slotValue.value = result;
+            slotValue.valueSet = true;
+            slotValue.calculated = true;
+        }
+        else {
+            slotValue.valueSet = false;
+            slotValue.calculated = false;
+            if (err && !firstErr)
+                firstErr = err;
+        }
+    }
+    return firstErr;
+}
+
+void SchemeModel::resetValues()
+{
+    // Blocks without an entry have no value to forget
+    for (size_t slot = 0; slot < values.size(); slot++) {
+        values[slot].calculated = false;
+        if (d.blocks[slot].type != Input)
+            values[slot].valueSet = false;
+    }
+}
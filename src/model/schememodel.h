@@ -0,0 +1,394 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Headless model of a block scheme.
+ * @file schememodel.h
+ *
+ *
+ */
+
+#ifndef SCHEMEMODEL_H
+#define SCHEMEMODEL_H
+
+#include <cstddef>
+#include <vector>
+#include "chunkedstorage.h"
+
+/**
+ * @brief The SchemeModel class holds the graph of a scheme (blocks, ports, edges, values)
+ * and evaluates it. It does not depend on Qt, the Scene only mirrors it for display.
+ *
+ * Blocks are addressed by their id from the outside. Internally they live in slots
+ * of a vector, edges are stored the same way, so the evaluation can work with plain indices.
+ *
+ * The model keeps the blocks in a topological order all the time. Every new edge updates the
+ * order with the Pearce-Kelly algorithm, which only visits the blocks between the two ends of
+ * the edge in the order. An edge that would close a loop is refused.
+ *
+ * Copying a model is cheap, the blocks, edges and the order are stored in chunks shared by the copies
+ * and a change copies only the chunks it touches. That makes a copy a snapshot of the scheme which can be
+ * read by another thread while the original is being edited. Values are not part of a copy, they are
+ * calculation state of the original only and changing them never copies anything.
+ */
+class SchemeModel
+{
+public:
+    /**
+     * @brief The BlockType enum contains a set of block's types, same as Block::blockType.
+     */
+    enum BlockType { Add, Sub, Mul, Div, Pow2, PowX, Sqrt, Input, Output };
+    /**
+     * @brief The EvalError enum contains a set of calculational errors, same as Block::calcError.
+     */
+    enum EvalError { NoErr=0, DivByZero };
+    /**
+     * @brief The ConnectError enum contains the reasons why connect() refuses an edge.
+     */
+    enum ConnectError { ConnectOk=0, NoSuchPort, PortTaken, FormsLoop };
+    /**
+     * @brief MaxInPorts is the highest number of input ports a block can have.
+     */
+    enum { MaxInPorts = 2 };
+    /**
+     * @brief The BlockRecord struct contains what the model knows about a block, its value is kept apart.
+     */
+    struct BlockRecord {
+        int id; /**< id of the block, -1 if the slot is free.*/
+        BlockType type; /**< type of the block.*/
+        int x; /**< x position in the scene.*/
+        int y; /**< y position in the scene.*/
+        int inEdges[MaxInPorts]; /**< edge connected to each input port, -1 if not connected.*/
+        int ord; /**< position of the block in the topological order.*/
+        bool inputSet; /**< whether the value of an Input block was set with setInputValue().*/
+        double inputValue; /**< value set with setInputValue(), kept with the scheme so snapshots can save it.*/
+        std::vector<int> outEdges; /**< edges leaving the output port, in order of creation.*/
+    };
+    /**
+     * @brief The Edge struct is a connection from an output port to an input port.
+     */
+    struct Edge {
+        int from; /**< slot of the source block, -1 if the edge slot is free.*/
+        int to; /**< slot of the target block.*/
+        int toPort; /**< number of the input port of the target block.*/
+    };
+    /**
+     * @brief The Listener class is told about every edit of the scheme, e.g. to record it in a journal.
+     * Calculated values are not edits, only values set with setInputValue() are.
+     */
+    class Listener {
+    public:
+        virtual ~Listener() {}
+        /**
+         * @brief blockAdded is called after a block was added.
+         * @param block The new block.
+         */
+        virtual void blockAdded(const BlockRecord& block) = 0;
+        /**
+         * @brief blockRemoved is called after a block was removed together with its edges.
+         * @param id Id of the removed block.
+         */
+        virtual void blockRemoved(int id) = 0;
+        /**
+         * @brief blockMoved is called after a block got a new position.
+         * @param id Id of the block.
+         */
+        virtual void blockMoved(int id) = 0;
+        /**
+         * @brief connected is called after an edge was created.
+         * @param fromId Id of the source block.
+         * @param toId Id of the target block.
+         * @param toPort Number of the input port of the target block.
+         */
+        virtual void connected(int fromId, int toId, int toPort) = 0;
+        /**
+         * @brief disconnected is called after an edge was removed by disconnect().
+         * @param toId Id of the target block.
+         * @param toPort Number of the input port of the target block.
+         */
+        virtual void disconnected(int toId, int toPort) = 0;
+        /**
+         * @brief inputValueChanged is called after the value of an Input block was set.
+         * @param id Id of the block.
+         */
+        virtual void inputValueChanged(int id) = 0;
+        /**
+         * @brief cleared is called after all blocks were removed.
+         */
+        virtual void cleared() = 0;
+    };
+
+    SchemeModel();
+    /**
+     * @brief SchemeModel makes a snapshot of the scheme of another model. Calculated values and the listener are not copied,
+     * values of Input blocks are a part of the scheme.
+     * @param other Model to copy.
+     */
+    SchemeModel(const SchemeModel& other);
+    /**
+     * @brief operator = makes the model a snapshot of the scheme of another model. Calculated values are dropped,
+     * the listener is kept.
+     * @param other Model to copy.
+     * @return this model.
+     */
+    SchemeModel& operator=(const SchemeModel& other);
+    /**
+     * @brief setListener sets the object told about edits of the scheme.
+     * @param listener The listener, NULL to stop telling anyone.
+     */
+    void setListener(Listener* listener);
+    /**
+     * @brief inPortCount returns the number of input ports of a block type.
+     * @param type Type of a block.
+     * @return number of input ports.
+     */
+    static int inPortCount(BlockType type);
+    /**
+     * @brief outPortCount returns the number of output ports of a block type.
+     * @param type Type of a block.
+     * @return number of output ports.
+     */
+    static int outPortCount(BlockType type);
+    /**
+     * @brief apply computes the operation of a block type.
+     * @param type Type of a block.
+     * @param input1 Value of the first input port.
+     * @param input2 Value of the second input port, ignored by one-input blocks.
+     * @param result Where the result is written, untouched on error.
+     * @return NoErr or the error of the operation.
+     */
+    static EvalError apply(BlockType type, double input1, double input2, double* result);
+
+    /**
+     * @brief addBlock adds a new block to the model.
+     * @param type Type of the block.
+     * @param id Id of the block, must not be in use.
+     * @param x X position of the block.
+     * @param y Y position of the block.
+     * @return true if the block was added, false if the id is already in use.
+     */
+    bool addBlock(BlockType type, int id, int x = 0, int y = 0);
+    /**
+     * @brief removeBlock removes a block together with all its edges.
+     * @param id Id of the block.
+     */
+    void removeBlock(int id);
+    /**
+     * @brief moveBlock updates the position of a block.
+     * @param id Id of the block.
+     * @param x New x position.
+     * @param y New y position.
+     */
+    void moveBlock(int id, int x, int y);
+    /**
+     * @brief connect creates an edge from the output of one block to an input port of another block.
+     * @param fromId Id of the source block.
+     * @param toId Id of the target block.
+     * @param toPort Number of the input port of the target block.
+     * @param error If given, filled with the reason of a refusal, or ConnectOk.
+     * @return true if the edge was created, false if a block or port does not exist, the port is taken
+     * or the edge would create a loop.
+     */
+    bool connect(int fromId, int toId, int toPort, ConnectError* error = NULL);
+    /**
+     * @brief disconnect removes the edge ending in a given input port.
+     * @param toId Id of the target block.
+     * @param toPort Number of the input port.
+     */
+    void disconnect(int toId, int toPort);
+    /**
+     * @brief clear removes all blocks and edges.
+     */
+    void clear();
+    /**
+     * @brief contains checks if a block with a given id exists.
+     * @param id Id of a block.
+     * @return true if the block exists.
+     */
+    bool contains(int id) const;
+    /**
+     * @brief isInputConnected checks if an input port has an edge.
+     * @param id Id of the block.
+     * @param port Number of the input port.
+     * @return true if an edge ends in the port.
+     */
+    bool isInputConnected(int id, int port) const;
+    /**
+     * @brief blockCount returns the number of blocks.
+     * @return number of blocks.
+     */
+    int blockCount() const;
+    /**
+     * @brief edgeCount returns the number of edges.
+     * @return number of edges.
+     */
+    int edgeCount() const;
+
+    /**
+     * @brief slotOf returns the slot of a block.
+     * @param id Id of a block.
+     * @return slot of the block, -1 if there is no such block.
+     */
+    int slotOf(int id) const;
+    /**
+     * @brief slotCount returns the number of block slots, including free ones.
+     * @return number of slots.
+     */
+    int slotCount() const;
+    /**
+     * @brief blockAt returns a block stored in a slot.
+     * @param slot Slot of a block.
+     * @return block record, its id is -1 if the slot is free.
+     */
+    const BlockRecord& blockAt(int slot) const;
+    /**
+     * @brief edgeSlotCount returns the number of edge slots, including free ones.
+     * @return number of edge slots.
+     */
+    int edgeSlotCount() const;
+    /**
+     * @brief edgeAt returns an edge stored in a slot.
+     * @param edge Slot of an edge.
+     * @return edge, its source is -1 if the slot is free.
+     */
+    const Edge& edgeAt(int edge) const;
+
+    /**
+     * @brief setInputValue sets the value of an Input block.
+     * @param id Id of the block.
+     * @param value New value.
+     */
+    void setInputValue(int id, double value);
+    /**
+     * @brief hasValue checks if a block has a value.
+     * @param id Id of the block.
+     * @return true if the block has a value.
+     */
+    bool hasValue(int id) const;
+    /**
+     * @brief value returns the value of a block.
+     * @param id Id of the block.
+     * @return value of the block, 0 if it has none.
+     */
+    double value(int id) const;
+    /**
+     * @brief inputHasValue checks if an input port has received a value in this run.
+     * @param id Id of the block.
+     * @param port Number of the input port.
+     * @return true if the block connected to the port has already been calculated.
+     */
+    bool inputHasValue(int id, int port) const;
+    /**
+     * @brief inputValue returns the value received by an input port.
+     * @param id Id of the block.
+     * @param port Number of the input port.
+     * @return value of the port, 0 if it has none.
+     */
+    double inputValue(int id, int port) const;
+    /**
+     * @brief allInputPortsConnected checks if every input port of every block is connected.
+     * @return true if all input ports are connected.
+     */
+    bool allInputPortsConnected() const;
+    /**
+     * @brief allInputBlocksInitialized checks if every Input block has a value.
+     * @return true if all Input blocks have a value.
+     */
+    bool allInputBlocksInitialized() const;
+
+    /**
+     * @brief findCycle looks for a loop in the scheme with an iterative three-colour depth-first search.
+     * Runs in time linear in the number of blocks and edges.
+     * @param cycle If given and a loop is found, filled with ids of the blocks on the loop in the order of the edges.
+     * @return true if the scheme contains a loop.
+     */
+    bool findCycle(std::vector<int>* cycle = NULL) const;
+    /**
+     * @brief buildPlan lists the blocks in the order of evaluation, which is the topological order kept by the model.
+     * @param plan Filled with slots of blocks, each block comes after all blocks it depends on.
+     * @return true if all blocks are in the plan. The model refuses loops, so it always succeeds.
+     */
+    bool buildPlan(std::vector<int>* plan) const;
+    /**
+     * @brief evaluateSlot calculates a single block from the values of its inputs.
+     * @param slot Slot of the block.
+     * @return NoErr or the error of the calculation.
+     */
+    EvalError evaluateSlot(int slot);
+    /**
+     * @brief evaluateAll calculates all blocks in the order of the plan.
+     * @return NoErr or the first error of the calculation.
+     */
+    EvalError evaluateAll();
+    /**
+     * @brief recalculateFrom recalculates only the blocks reachable from a given block, e.g. after its value changed.
+     * The blocks are calculated in topological order. A block whose inputs do not all have a value loses its value.
+     * @param id Id of the block where the change happened.
+     * @param changed If given, filled with slots of the recalculated blocks.
+     * @return NoErr or the first error of the calculation.
+     */
+    EvalError recalculateFrom(int id, std::vector<int>* changed = NULL);
+    /**
+     * @brief recalculateAll recalculates all blocks the same way as recalculateFrom().
+     * @param changed If given, filled with slots of the recalculated blocks.
+     * @return NoErr or the first error of the calculation.
+     */
+    EvalError recalculateAll(std::vector<int>* changed = NULL);
+    /**
+     * @brief resetValues forgets all calculated values, values of Input blocks are kept.
+     */
+    void resetValues();
+    /**
+     * @brief revision returns a number which grows with every change of blocks, their positions, edges
+     * or values of Input blocks. Calculated values are not counted, they are not stored in a file.
+     * @return revision of the scheme.
+     */
+    unsigned long long revision() const;
+private:
+    /**
+     * @brief The Data struct holds the scheme. Copies of a model share its unchanged chunks.
+     */
+    struct Data {
+        ChunkedVector<BlockRecord> blocks; /**< block slots.*/
+        ChunkedVector<int> freeBlocks; /**< free block slots.*/
+        ChunkedVector<Edge> edges; /**< edge slots.*/
+        ChunkedVector<int> freeEdges; /**< free edge slots.*/
+        ChunkedMap slotById; /**< slot of each block id.*/
+        int numberOfEdges; /**< number of used edge slots.*/
+        ChunkedVector<int> topoOrder; /**< slots in topological order, -1 where a removed block was.*/
+        int topoHoles; /**< number of -1 entries in topoOrder.*/
+        unsigned long long revision; /**< number of changes of the scheme itself.*/
+
+        Data();
+    };
+    /**
+     * @brief The SlotValue struct is the calculation state of a block.
+     */
+    struct SlotValue {
+        double value; /**< value of the block.*/
+        bool valueSet; /**< whether the block has a value.*/
+        bool calculated; /**< whether the block was already calculated in this run.*/
+
+        SlotValue();
+    };
+    Data d; /**< the scheme, sharing chunks with snapshots.*/
+    std::vector<SlotValue> values; /**< values indexed by slot, shorter than the slots until they get a value.*/
+    std::vector<unsigned> visitMark; /**< slots visited by a traversal, compared with visitEpoch.*/
+    unsigned visitEpoch; /**< number of the current traversal, so marks need no clearing.*/
+    std::vector<int> coneDegree; /**< in-degree inside the recalculated part of the scheme, indexed by slot.*/
+    Listener* listener; /**< object told about edits, may be NULL.*/
+
+    const SlotValue& valueAt(int slot) const;
+    SlotValue& editValue(int slot);
+    void prepareTraversal();
+    void removeEdge(int edge);
+    bool reorder(int from, int to);
+    void compactOrder();
+    EvalError recalculate(const std::vector<int>& order, std::vector<int>* changed);
+    double slotInputValue(int slot, int port) const;
+};
+
+#endif // SCHEMEMODEL_H
@@ -14,14 +14,17 @@
 #include "port.h"
 #include "block.h"
 
-Port::Port(Block* parentBlock, portType type, int numberOfPorts, int position)
+#include <QStyleOptionGraphicsItem>
+
+/** Below this scale, ports are not drawn at all. */
+static const qreal LowDetail = 0.4;
+
+Port::Port(Block* parentBlock, portType type, int numberOfPorts, int position) : QGraphicsItem(parentBlock)
 {
     this->parent = parentBlock;
     this->pType = type;
-    dataSet = false;
     selected = false;
     numberOfPort = position;
-    setFlag(ItemSendsScenePositionChanges);
 
     // Calculation of position inside the block
     QRectF rect = parentBlock->boundingRect();
@@ -35,11 +38,13 @@ Port::Port(Block* parentBlock, portType type, int numberOfPorts, int position)
     relPos.setY(relPos.y() - boundingRect().height()/2);
     relPos.setX(relPos.x() - boundingRect().width()/2);
 
-    // Calculation of position on the scene
-    QPointF p = parentBlock->pos();
-    p.setX(p.x() + relPos.x());
-    p.setY(p.y() + relPos.y());
-    setPos(p);
+    // A child of the block, it moves with it
+    setPos(relPos);
+}
+
+Port::~Port()
+{
+    qDeleteAll(conList);
 }
 
 int Port::type() const
@@ -86,42 +91,25 @@ QRectF Port::boundingRect() const
     return QRectF(0, 0, 14, 14);
 }
 
-QVariant Port::itemChange(QGraphicsItem::GraphicsItemChange change, const QVariant &value)
+QPointF Port::centerPos()
 {
-    if (change == ItemPositionChange && scene()) {
-        QPointF newPos = value.toPointF();
-        moveLinesToCenter(newPos);
-    }
-    return QGraphicsItem::itemChange(change, value);
+    return mapToScene(boundingRect().center());
 }
 
-void Port::moveLinesToCenter(QPointF newPos) {
-    // Convert the port position (top-left) to its center position
-    int xOffset = boundingRect().x() + boundingRect().width()/2;
-    int yOffset = boundingRect().y() + boundingRect().height()/2;
-
-    QPointF newCenterPos = QPointF(newPos.x() + xOffset, newPos.y() + yOffset);
-
-    // Move the required point of the line to the center of the port
+void Port::collectLines(QSet<Line*>* lines)
+{
     foreach(BlockConnection* connection, conList) {
-        QPointF p1;
-        QPointF p2;
-        if (connection->isFirstPoint()) {
-            p1 = newCenterPos;
-            p2 = connection->getLine()->line().p2();
-        } else {
-            p1 = connection->getLine()->line().p1();
-            p2 = newCenterPos;
-        }
-        connection->getLine()->setLine(QLineF(p1, p2));
-        connection->getLine()->update();
+        lines->insert(connection->getLine());
     }
 }
 
 void Port::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *parent)
 {
     Q_UNUSED(parent);
-    Q_UNUSED(option);
+
+    // A few pixels, covered by the block and its lines anyway
+    if (option->levelOfDetailFromTransform(painter->worldTransform()) < LowDetail)
+        return;
 
     QRectF rectangle = boundingRect();
 
@@ -148,7 +136,6 @@ void Port::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWid
 
 void Port::addConnection(Line* line, bool isFirstPoint, Port* firstPort, Port* secondPort) {
     BlockConnection* newConnect = new BlockConnection(line, isFirstPoint, firstPort, secondPort);
-    qDebug() << "Creating a new connection for ports:" << firstPort << secondPort;
     conList.append(newConnect);
 }
 
@@ -181,6 +168,13 @@ QList<Port*> Port::getNextPorts()
 }
 
 bool Port::isConnected()
+{
+    if (hasLine()) return true;
+    // Only the model knows about a connection to a block which has no item
+    return pType == InPort && parent->isInputConnected(numberOfPort);
+}
+
+bool Port::hasLine()
 {
     if (conList.size() == 0) return false;
     return true;
@@ -216,31 +210,24 @@ void Port::removeConnections(QList<QGraphicsLineItem*>* toDelete) {
 
 void Port::removeConnection(QGraphicsLineItem* line) {
     // Remove a single connection from the port
-    foreach(BlockConnection* connection, conList) {
-        if (connection->getLine() == line) {
-            conList.removeOne(connection);
+    for (int i = 0; i < conList.size(); i++) {
+        if (conList.at(i)->getLine() == line) {
+            delete conList.takeAt(i);
+            return;
         }
     }
 }
 
 double Port::getData()
 {
-    if (!dataSet) return 0;
-    return inputData;
-}
-
-void Port::setData(double data)
-{
-    inputData = data;
-    dataSet = true;
+    if (pType == OutPort)
+        return parent->getData();
+    return parent->getInputData(numberOfPort);
 }
 
 bool Port::areDataSet()
 {
-    return dataSet;
-}
-
-void Port::unsetData()
-{
-    dataSet = false;
+    if (pType == OutPort)
+        return parent->areDataSet();
+    return parent->areInputDataSet(numberOfPort);
 }
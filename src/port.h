@@ -18,6 +18,7 @@
 #include <QGraphicsItem>
 #include <QPainter>
 #include <QDebug>
+#include <QSet>
 
 #include "blockconnection.h"
 
@@ -43,6 +44,10 @@ public:
      * @param position is a position of a port on the block.
      */
     Port(Block* parentBlock, portType type, int numberOfPorts, int position);
+    /**
+     * @brief ~Port is the destructor, it frees the connection records of the port.
+     */
+    ~Port();
 
     /**
      * @brief type returns the type of a port.
@@ -70,16 +75,19 @@ public:
      */
     QRectF boundingRect() const;
     /**
-     * @brief itemChange determines the position of a port, a calls a function to move lines.
-     * @param change controls port state.
-     * @param value is a new position of a port.
-     * @return this function.
+     * @brief centerPos returns the center of a port, where its lines end.
+     * @return the center in the scene's coordinates.
+     */
+    QPointF centerPos();
+    /**
+     * @brief collectLines adds the lines of all connections of the port to a set.
+     * @param lines Set of lines.
      */
-    QVariant itemChange(GraphicsItemChange change, const QVariant &value);
+    void collectLines(QSet<Line*>* lines);
     /**
      * @brief paint draws ports.
      * @param painter is a pointer to painter.
-     * @param option is a pointer to style's options. Doesn't use.
+     * @param option is a pointer to style's options, ports are skipped at a low level of detail.
      * @param parent is a pointer to the parent. Doesn't use.
      */
     void paint(QPainter *painter,const QStyleOptionGraphicsItem *option, QWidget *parent);
@@ -108,10 +116,16 @@ public:
      */
     QList<Port*> getNextPorts();
     /**
-     * @brief isConnected checks if the port is connected or not.
+     * @brief isConnected checks if the port is connected or not. An input port connected to a block
+     * without an item has no line, but it is connected too.
      * @return bool value. True is if it is a connected, otherwise False is.
      */
     bool isConnected();
+    /**
+     * @brief hasLine checks if the port has a connection with a line, i.e. to a block which has an item.
+     * @return bool value. True if a line ends in the port, otherwise it is False.
+     */
+    bool hasLine();
     /**
      * @brief isInput checks if this port's type is a Inport.
      * @return bool value. True is if it is a connected, otherwise False is.
@@ -138,24 +152,15 @@ public:
      */
     void removeConnection(QGraphicsLineItem* line);
     /**
-     * @brief getData return value what contains port's block.
-     * @return data of a block.
+     * @brief getData returns the value received by an input port or the value of the block of an output port.
+     * @return data of the port.
      */
     double getData();
     /**
-     * @brief setData writes data to the block, where this port is.
-     * @param data is a value, what must be written.
-     */
-    void setData(double data);
-    /**
-     * @brief areDataSet checks if port's block has data.
-     * @return bool value. True is if port's block has a data, otherwise it is False.
+     * @brief areDataSet checks if the port has data.
+     * @return bool value. True is if the port has a data, otherwise it is False.
      */
     bool areDataSet();
-    /**
-     * @brief unsetData sets data to False.
-     */
-    void unsetData();
     /**
      * @brief numberOfPortRec returns the number of a port.
      * @return the number of a port.
@@ -177,17 +182,10 @@ public:
 private:
     portType pType; /**< type of a port.*/
     Block* parent; /**< block that contains this port.*/
-    QPointF relPos; /**< position of a port in the scene relatively to it's block.*/
-    double inputData; /**< data contained in the port.*/
-    bool dataSet; /**< for checking if the port has data.*/
+    QPointF relPos; /**< position of a port relatively to it's block, which is its parent item.*/
     bool selected; /**< for checing whether the port is selected.*/
     int numberOfPort; /**< number of the port*/
     QList<BlockConnection*> conList; /**< list of connections*/
-    /**
-     * @brief moveLinesToCenter moves lines, when block is moving.
-     * @param newPos is a new position.
-     */
-    void moveLinesToCenter(QPointF newPos);
 };
 
 #endif // PORT_H
@@ -20,29 +20,60 @@ Scene::Scene(QObject* parent): QGraphicsScene(parent){
     secondPort = 0;
     calculationComplete = false;
     lastCalculated = NULL;
+    calcPlanPos = 0;
+    liveUpdate = false;
+    tileSize = 1024;
+    virtualized = false;
+    repaintTimer = new QTimer(this);
+    repaintTimer->setSingleShot(true);
+    repaintTimer->setInterval(0);
+    connect(repaintTimer, SIGNAL(timeout()), this, SLOT(repaintDirty()));
+    unselectTimer = new QTimer(this);
+    unselectTimer->setSingleShot(true);
+    unselectTimer->setInterval(200);
+    connect(unselectTimer, SIGNAL(timeout()), this, SLOT(unselectConnectedPorts()));
+    valueEditor = NULL;
+    editorProxy = NULL;
+    editedBlock = NULL;
+    edgeLayer = NULL;
+}
+
+Scene::~Scene()
+{
+    // Lines drawn by the edge layer are not items of the scene
+    if (edgeLayer)
+        qDeleteAll(lineSet);
+    foreach (const QList<Block*> &pool, blockPool) {
+        // The ports are child items, deleted with their block
+        foreach (Block* block, pool)
+            delete block;
+    }
+    qDeleteAll(linePool);
 }
 
 void Scene::setMode(Mode mode){
     sceneMode = mode;
     QGraphicsView::DragMode vMode = QGraphicsView::NoDrag;
     if(mode == DrawLine){
-        makeItemsControllable(false);
+        // Items keep their flags, only the selection has to go
+        clearSelection();
+        if (edgeLayer)
+            edgeLayer->clearSelection();
         vMode = QGraphicsView::NoDrag;
         // Reset the first/second block selection
         if (firstPort) {
             firstPort->unselectPort();
-            redrawScene();
+            markDirty(firstPort);
         }
         firstPort = 0;
         secondPort = 0;
     }
     else if(mode == SelectObject){
-        makeItemsControllable(true);
         vMode = QGraphicsView::RubberBandDrag;
         // Reset the first/second block selection
         if (firstPort) {
             firstPort->unselectPort();
-            redrawScene();
+            markDirty(firstPort);
         }
         firstPort = 0;
         secondPort = 0;
@@ -58,62 +89,96 @@ Scene::Mode Scene::getMode() {
 
 void Scene::addItem(Block *block)
 {
+    // Adds the ports too, they are child items of the block
     QGraphicsScene::addItem(block);
-    foreach (Port* port, block->getPortList()) {
-        QGraphicsScene::addItem(port);
-    }
 }
 
 void Scene::blockListAppend(Block* block) {
     blockList.append(block);
+    blockIndex.insert(block->idBlock(), block);
+    model.addBlock(SchemeModel::BlockType(block->getBlockType()), block->idBlock(),
+                   qRound(block->pos().x()), qRound(block->pos().y()));
+    invalidateCalcPlan();
 }
 
-QList<Port*> Scene::getScenePorts()
+Port* Scene::portAt(const QPointF &position)
 {
-    QList<Port*> list;
-    foreach (Block* block, blockList) {
-        list.append(block->getPortList());
-    }
-    return list;
-}
-
-
-void Scene::makeItemsControllable(bool areControllable) {
-    foreach(QGraphicsItem* item, items()){
-        if (item->type() == Block::Type) {
-            item->setFlag(QGraphicsItem::ItemIsMovable, areControllable);
-            item->setFlag(QGraphicsItem::ItemIsSelectable, areControllable);
-        }
-        else if (item->type() == QGraphicsLineItem::Type) {
-            item->setFlag(QGraphicsItem::ItemIsSelectable, areControllable);
+    // Only items near the point are asked from the index, the port with the nearest center wins
+    QRectF area(position.x() - SnapRadius, position.y() - SnapRadius, 2 * SnapRadius, 2 * SnapRadius);
+    Port* nearest = NULL;
+    qreal nearestDistance = SnapRadius;
+    foreach (QGraphicsItem* item, items(area, Qt::IntersectsItemBoundingRect)) {
+        if (item->type() != Port::Type)
+            continue;
+        Port* port = (Port*)item;
+        qreal distance = QLineF(port->centerPos(), position).length();
+        if (distance <= nearestDistance) {
+            nearestDistance = distance;
+            nearest = port;
         }
     }
+    return nearest;
 }
 
+
 void Scene::mousePressEvent(QGraphicsSceneMouseEvent *event) {
+    // A click anywhere else ends the editing of a value
+    if (editedBlock && itemAt(event->scenePos(), QTransform()) != editorProxy)
+        finishEditing();
+    if (event->button() == Qt::LeftButton && startEditingAt(event->scenePos())) {
+        event->accept();
+        return;
+    }
+    // The lines of the edge layer are unselected like items, unless the click hits one of them
+    if (edgeLayer && !(event->modifiers() & Qt::ControlModifier) &&
+        itemAt(event->scenePos(), QTransform()) != edgeLayer)
+        edgeLayer->clearSelection();
     if(sceneMode == DrawLine) {
         if (!firstPort) {
-            getClickedFirstPort();
+            getClickedFirstPort(event->scenePos());
         }
         else {
-            getClickedSecondPort();
+            getClickedSecondPort(event->scenePos());
         }
     }
+    // Blocks and lines are always movable and selectable, but only the select mode lets them know
+    if (!itemsControllable(event->scenePos())) {
+        event->accept();
+        return;
+    }
     QGraphicsScene::mousePressEvent(event);
 }
 
-void Scene::getClickedFirstPort()
+void Scene::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
+    // Items handle a double click as a press, which would select them
+    if (!itemsControllable(event->scenePos())) {
+        event->accept();
+        return;
+    }
+    QGraphicsScene::mouseDoubleClickEvent(event);
+}
+
+bool Scene::itemsControllable(const QPointF &position)
+{
+    if (sceneMode == SelectObject)
+        return true;
+    // The value editor takes clicks in any mode
+    return editorProxy && editedBlock && itemAt(position, QTransform()) == editorProxy;
+}
+
+void Scene::mouseMoveEvent(QGraphicsSceneMouseEvent *event) {
+    // All selected blocks are dragged by the base class, then their lines are moved in one pass
+    QGraphicsScene::mouseMoveEvent(event);
+    updateMovedLines();
+}
+
+void Scene::getClickedFirstPort(const QPointF &position)
 {
     // Get status bar
     QStatusBar* bar = ((MainWindow*)parent())->statusBar();
 
-    // Find the port under the mouse
-    foreach(Port* port, getScenePorts()) {
-        if (port->isUnderMouse()) {
-            firstPort = port;
-            break;
-        }
-    }
+    // Find the port under the mouse or close to it
+    firstPort = portAt(position);
     bar->showMessage(selectedPorts(), 2000);
 
     // Check the result
@@ -124,22 +189,17 @@ void Scene::getClickedFirstPort()
         }
         else {
             firstPort->selectPort();
-            redrawScene();
+            markDirty(firstPort);
         }
     }
 }
-void Scene::getClickedSecondPort()
+void Scene::getClickedSecondPort(const QPointF &position)
 {
     // Get status bar
     QStatusBar* bar = ((MainWindow*)parent())->statusBar();
 
-    // Find the port under the mouse
-    foreach(Port* port, getScenePorts()){
-        if (port->isUnderMouse()) {
-            secondPort = port;
-            break;
-        }
-    }
+    // Find the port under the mouse or close to it
+    secondPort = portAt(position);
     bar->showMessage(selectedPorts(), 2000);
 
     // Check the result
@@ -157,7 +217,7 @@ void Scene::getClickedSecondPort()
     }
 }
 
-void Scene::createConnection(Port* firstP, Port* secondP)
+bool Scene::createConnection(Port* firstP, Port* secondP)
 {
     if (firstP) firstPort = firstP;
     if (secondP) secondPort = secondP;
@@ -167,49 +227,126 @@ void Scene::createConnection(Port* firstP, Port* secondP)
         firstPort = secondPort;
         secondPort = aux;
     }
-    QPointF pos1;
-    QPointF pos2;
-    pos1.setX(firstPort->scenePos().x() + firstPort->boundingRect().width()/2);
-    pos1.setY(firstPort->scenePos().y() + firstPort->boundingRect().height()/2);
-    pos2.setX(secondPort->scenePos().x() + secondPort->boundingRect().width()/2);
-    pos2.setY(secondPort->scenePos().y() + secondPort->boundingRect().height()/2);
 
-    Line* lineToDraw = addLine(QLineF(pos1, pos2));
-    firstPort->addConnection(lineToDraw, true, firstPort, secondPort);
-    secondPort->addConnection(lineToDraw, false, firstPort, secondPort);
+    SchemeModel::ConnectError error;
+    if (!connectPorts(firstPort, secondPort, &error)) {
+        QStatusBar* bar = ((MainWindow*)parent())->statusBar();
+        if (error == SchemeModel::FormsLoop)
+            bar->showMessage("Cannot create a connection that forms a loop.", 2000);
+        else if (error == SchemeModel::PortTaken)
+            bar->showMessage("Input port can have one connection at most.", 2000);
+        else
+            bar->showMessage("Cannot create this connection.", 2000);
+        portUnselect(firstPort, secondPort);
+        firstPort = 0;
+        secondPort = 0;
+        return false;
+    }
     firstPort->selectPort();
     secondPort->selectPort();
-    redrawScene();
-    Port* first = firstPort;
-    Port* second = secondPort;
-    QTimer::singleShot(200, this, [this, first, second] () {portUnselect(first, second); });
+    markDirty(firstPort);
+    markDirty(secondPort);
+    inputValueChanged(secondPort->parentBlock());
+    // The ports stay highlighted for a moment, a released or deleted block takes its ports off the list
+    connectedPorts << firstPort << secondPort;
+    unselectTimer->start();
     firstPort = 0;
     secondPort = 0;
+    return true;
+}
+
+Line* Scene::connectPorts(Port* outPort, Port* inPort, SchemeModel::ConnectError* error)
+{
+    if (!model.connect(outPort->parentBlock()->idBlock(), inPort->parentBlock()->idBlock(),
+                       inPort->numberOfPortRec(), error))
+        return NULL;
+    invalidateCalcPlan();
+    return addConnectionLine(outPort, inPort);
+}
+
+Line* Scene::addConnectionLine(Port* outPort, Port* inPort)
+{
+    Line* lineToDraw = addLine(QLineF(outPort->centerPos(), inPort->centerPos()), outPort, inPort);
+    lineSet.insert(lineToDraw);
+    outPort->addConnection(lineToDraw, true, outPort, inPort);
+    inPort->addConnection(lineToDraw, false, outPort, inPort);
+    return lineToDraw;
 }
 
-Line* Scene::addLine(const QLineF &line)
+Line* Scene::addLine(const QLineF &line, Port* startPort, Port* endPort)
 {
-    Line* newLine = new Line(line, secondPort);
-    QGraphicsScene::addItem(newLine);
+    Line* newLine;
+    if (linePool.isEmpty()) {
+        newLine = new Line(line, startPort, endPort);
+    }
+    else {
+        newLine = linePool.takeLast();
+        newLine->reconnect(line, startPort, endPort);
+    }
+    if (edgeLayer)
+        edgeLayer->addEdge(newLine);
+    else
+        QGraphicsScene::addItem(newLine);
     return newLine;
 }
 
+void Scene::takeLine(Line* line)
+{
+    lineSet.remove(line);
+    dirtyItems.remove(line);
+    if (edgeLayer)
+        edgeLayer->removeEdge(line);
+    else
+        removeItem(line);
+}
+
+void Scene::setEdgeLayer(bool enabled)
+{
+    if (enabled == (edgeLayer != NULL))
+        return;
+    if (enabled) {
+        edgeLayer = new EdgeLayer(this);
+        QGraphicsScene::addItem(edgeLayer);
+        foreach (Line* line, lineSet) {
+            line->setSelected(false);
+            dirtyItems.remove(line);
+            removeItem(line);
+            edgeLayer->addEdge(line);
+        }
+    }
+    else {
+        foreach (Line* line, lineSet) {
+            QGraphicsScene::addItem(line);
+        }
+        removeItem(edgeLayer);
+        delete edgeLayer;
+        edgeLayer = NULL;
+    }
+}
+
 QString Scene::selectedPorts() {
     QString x1, y1, x2, y2;
     x1 = y1 = x2 = y2 = "  ";
     if (firstPort) {
-        x1 = x1.number(firstPort->pos().x());
-        y1 = y1.number(firstPort->pos().y());
+        x1 = x1.number(firstPort->scenePos().x());
+        y1 = y1.number(firstPort->scenePos().y());
     }
     if (secondPort) {
-        x2 = x2.number(secondPort->pos().x());
-        y2 = y2.number(secondPort->pos().y());
+        x2 = x2.number(secondPort->scenePos().x());
+        y2 = y2.number(secondPort->scenePos().y());
     }
     return QString("First port: (%1,%2) Second port: (%3,%4)").arg(x1, y1, x2, y2);
 }
 
 void Scene::keyPressEvent(QKeyEvent *event){
-    if (event->key() == Qt::Key_Delete)
+    // Keys typed into the value editor are its own
+    if (editedBlock) {
+        if (event->key() == Qt::Key_Escape)
+            finishEditing();
+        else
+            QGraphicsScene::keyPressEvent(event);
+    }
+    else if (event->key() == Qt::Key_Delete)
         deleteSelectedItems();
     else if (event->key() == Qt::Key_Escape) {
         portUnselect(firstPort, secondPort);
@@ -221,16 +358,48 @@ void Scene::keyPressEvent(QKeyEvent *event){
 }
 
 void Scene::deleteSelectedItems(){
+    // Blocks that lose an input and have to be recalculated in live mode
+    QList<Block*> affected;
+
     // First all the selected lines must be deleted
     foreach(QGraphicsItem* item, selectedItems()){
         if (item->type() == QGraphicsLineItem::Type) {
+            affected.append(((Line*)item)->getEndPort()->parentBlock());
             deleteLine((QGraphicsLineItem*)item);
         }
     }
+    if (edgeLayer) {
+        foreach(Line* line, edgeLayer->selectedEdges()) {
+            affected.append(line->getEndPort()->parentBlock());
+            deleteLine(line);
+        }
+    }
     // Then all the blocks
+    QSet<Block*> deleted;
     foreach(QGraphicsItem* item, selectedItems()){
         if (item->type() == Block::Type) {
-            deleteBlock((Block*)item);
+            Block* block = (Block*)item;
+            if (liveUpdate)
+                affected.append(block->getNextBlocks());
+            deleteBlock(block, false);
+            deleted.insert(block);
+        }
+    }
+    // One pass over the list instead of a search for every deleted block
+    if (!deleted.isEmpty()) {
+        QList<Block*> remaining;
+        remaining.reserve(blockList.size() - deleted.size());
+        foreach (Block* block, blockList) {
+            if (!deleted.contains(block))
+                remaining.append(block);
+        }
+        blockList = remaining;
+    }
+
+    if (liveUpdate) {
+        foreach (Block* block, affected) {
+            if (!deleted.contains(block))
+                inputValueChanged(block);
         }
     }
 }
@@ -238,138 +407,186 @@ void Scene::deleteSelectedItems(){
 void Scene::deleteAll(){
 
     foreach (Block* delBlock, blockList) {
-        deleteBlock(delBlock);
+        deleteBlock(delBlock, false);
     }
+    blockList.clear();
+    pendingTiles.clear();
+    model.clear();
 }
 
-void Scene::deleteLine(QGraphicsLineItem* line) {
-    foreach(Port* port, getScenePorts()){
-        port->removeConnection(line);
-    }
-    removeItem(line);
+void Scene::deleteLine(QGraphicsLineItem* item) {
+    // The line knows both its ports, no other port has to be touched
+    Line* line = (Line*)item;
+    Port* endPort = line->getEndPort();
+    model.disconnect(endPort->parentBlock()->idBlock(), endPort->numberOfPortRec());
+    line->getStartPort()->removeConnection(line);
+    endPort->removeConnection(line);
+    takeLine(line);
     delete line;
+    invalidateCalcPlan();
 }
 
-void Scene::deleteBlock(Block* block) {
+void Scene::deleteBlock(Block* block, bool removeFromList) {
+    model.removeBlock(block->idBlock());
     QList<QGraphicsLineItem*> toDelete;
     foreach(Port* port, block->getPortList()) {
         port->removeConnections(&toDelete);
-        block->removePort(port);
     }
-    foreach(QGraphicsLineItem* line, toDelete) {
-        foreach(Port* port, getScenePorts()) {
-            port->removeConnection(line);
-        }
-        removeItem(line);
+    foreach(QGraphicsLineItem* item, toDelete) {
+        Line* line = (Line*)item;
+        line->getStartPort()->removeConnection(line);
+        line->getEndPort()->removeConnection(line);
+        takeLine(line);
         delete line;
     }
-    blockList.removeOne(block);
+    forgetDirty(block);
+    forgetPorts(block);
+    if (editedBlock == block)
+        finishEditing();
+    foreach(Port* port, block->getPortList()) {
+        block->removePort(port);
+    }
+    if (removeFromList)
+        blockList.removeOne(block);
+    blockIndex.remove(block->idBlock());
+    if (lastCalculated == block)
+        lastCalculated = NULL;
+    invalidateCalcPlan();
     removeItem(block);
     delete block;
 }
 
-bool Scene::containsLoops()
+bool Scene::containsLoops(QList<Block*>* loop)
 {
-    foreach (Block* block, blockList) {
-        foreach (Block* nextBlock, block->getNextBlocks()) {
-            if (nextBlock->containsLoops(block))
-                return true;
+    std::vector<int> cycle;
+    if (!model.findCycle(&cycle))
+        return false;
+
+    if (loop) {
+        loop->clear();
+        for (size_t i = 0; i < cycle.size(); i++) {
+            Block* block = getBlock(cycle[i]);
+            if (block)
+                loop->append(block);
         }
     }
-    return false;
+    return true;
 }
 
 bool Scene::allInputPortsConnected()
 {
-    foreach (Block* block, blockList) {
-        if (!block->allInputPortsConnected())
-            return false;
-    }
-    return true;
+    return model.allInputPortsConnected();
 }
 
 bool Scene::allInputBlocksInitialized()
 {
-    foreach (Block* block, blockList) {
-        if (block->getBlockType() == Block::Input && !block->areDataSet())
-            return false;
-    }
-    return true;
+    return model.allInputBlocksInitialized();
 }
 
 void Scene::calculateAll(Block::calcError* err)
 {
-    if (toCalculate.empty()) {
-        toCalculate.append(blockList);
-    }
-    foreach (Block* block, toCalculate) {
-        if (block->getBlockType() == Block::Input) {
-            calculateHelperFunc(err, block);
-        }
-    }
-    while (!toCalculate.empty()) {
-        foreach (Block* block, toCalculate) {
-            if (block->allInputsSet()) {
-                calculateHelperFunc(err, block);
-                if (*err) {
-                    calculationComplete = true;
-                    return;
-                }
-            }
-        }
+    if (calcPlan.isEmpty())
+        buildCalcPlan();
+    while (calcPlanPos < calcPlan.size()) {
+        calculateHelperFunc(err, calcPlan.at(calcPlanPos++));
+        if (*err)
+            break;
     }
     calculationComplete = true;
 }
 
 void Scene::calculateNext(Block::calcError* err)
 {
-    if (toCalculate.empty()) {
-        toCalculate.append(blockList);
-    }
-    foreach (Block* block, toCalculate) {
-        if (block->getBlockType() == Block::Input) {
-            calculateHelperFunc(err, block);
-            return;
-        }
-    }
-    foreach (Block* block, toCalculate) {
-        if (block->allInputsSet()) {
-            calculateHelperFunc(err, block);
-            if (toCalculate.empty()) {
-                calculationComplete = true;
-            }
-            break;
-        }
-    }
-    if (*err) {
+    if (calcPlan.isEmpty())
+        buildCalcPlan();
+    if (calcPlanPos < calcPlan.size())
+        calculateHelperFunc(err, calcPlan.at(calcPlanPos++));
+    if (*err || calcPlanPos >= calcPlan.size())
         calculationComplete = true;
-        return;
+}
+
+void Scene::calculateHelperFunc(Block::calcError* err, int slot) {
+    SchemeModel::EvalError modelErr = model.evaluateSlot(slot);
+    if (modelErr)
+        *err = Block::calcError(modelErr);
+    // Blocks outside of the loaded part of the scheme are calculated without an item
+    Block* block = getBlock(model.blockAt(slot).id);
+    if (block)
+        block->updateOutputField();
+    setLastCalculated(block);
+}
+
+bool Scene::buildCalcPlan()
+{
+    calcPlan.clear();
+    calcPlanPos = 0;
+
+    std::vector<int> plan;
+    bool complete = model.buildPlan(&plan);
+
+    calcPlan.reserve(int(plan.size()));
+    for (size_t i = 0; i < plan.size(); i++) {
+        calcPlan.append(plan[i]);
     }
+    return complete;
 }
 
-void Scene::calculateHelperFunc(Block::calcError* err, Block* block) {
-    block->doCalculation(err);
-    toCalculate.removeOne(block);
-    lastCalculated = block;
-    redrawScene();
+void Scene::invalidateCalcPlan()
+{
+    calcPlan.clear();
+    calcPlanPos = 0;
+}
+
+void Scene::setLiveUpdate(bool enabled)
+{
+    liveUpdate = enabled;
+    if (!liveUpdate)
+        return;
+
+    resetCalculation();
+    std::vector<int> changed;
+    SchemeModel::EvalError err = model.recalculateAll(&changed);
+    showRecalculated(changed, err);
+}
+
+void Scene::inputValueChanged(Block* block)
+{
+    if (!liveUpdate)
+        return;
+
+    std::vector<int> changed;
+    SchemeModel::EvalError err = model.recalculateFrom(block->idBlock(), &changed);
+    showRecalculated(changed, err);
+}
+
+void Scene::showRecalculated(const std::vector<int>& changed, SchemeModel::EvalError err)
+{
+    // Only outputs display their value, other blocks show it in a tooltip on demand
+    for (size_t i = 0; i < changed.size(); i++) {
+        const SchemeModel::BlockRecord& record = model.blockAt(changed[i]);
+        if (record.type != SchemeModel::Output)
+            continue;
+        Block* block = getBlock(record.id);
+        if (block)
+            block->updateOutputField();
+    }
+    if (err) {
+        QStatusBar* bar = ((MainWindow*)parent())->statusBar();
+        bar->showMessage("Error: Division by zero.", 2000);
+    }
 }
 
 void Scene::resetCalculation()
 {
     calculationComplete = false;
-    toCalculate.clear();
-    lastCalculated = NULL;
+    invalidateCalcPlan();
+    setLastCalculated(NULL);
+    model.resetValues();
     foreach (Block* block, blockList) {
         if (block->getBlockType() == Block::Output) {
             block->clearOutputField();
         }
-        if (block->getBlockType() != Block::Input)
-            block->unsetData();
-        foreach (Port* port, block->getPortList()) {
-            port->unsetData();
-        }
     }
-    redrawScene();
 }
 
 bool Scene::allCalculated()
@@ -389,67 +606,505 @@ void Scene::setCalcComplete()
     calculationComplete = true;
 }
 
-void Scene::redrawScene()
+void Scene::markDirty(QGraphicsItem* item)
+{
+    if (!item || item->scene() != this)
+        return;
+    dirtyItems.insert(item);
+    if (!repaintTimer->isActive())
+        repaintTimer->start();
+}
+
+void Scene::blockMoved(Block* block)
 {
-    qDebug() << "redrawing scene";
-    foreach (QGraphicsItem* item, items()) {
+    movedBlocks.insert(block);
+    // Moves outside of a drag are finished before the next repaint
+    if (!repaintTimer->isActive())
+        repaintTimer->start();
+}
+
+void Scene::updateMovedLines()
+{
+    if (movedBlocks.isEmpty())
+        return;
+    // A line between two moved blocks is set only once
+    QSet<Line*> lines;
+    foreach (Block* block, movedBlocks) {
+        foreach (Port* port, block->getPortList())
+            port->collectLines(&lines);
+    }
+    movedBlocks.clear();
+    foreach (Line* line, lines) {
+        line->setLine(QLineF(line->getStartPort()->centerPos(), line->getEndPort()->centerPos()));
+        if (edgeLayer)
+            edgeLayer->updateEdge(line);
+    }
+}
+
+void Scene::repaintDirty()
+{
+    updateMovedLines();
+    // Taken first, the updates must not see a set which is being changed
+    QSet<QGraphicsItem*> items;
+    items.swap(dirtyItems);
+    foreach (QGraphicsItem* item, items)
         item->update();
+}
+
+void Scene::forgetDirty(Block* block)
+{
+    movedBlocks.remove(block);
+    dirtyItems.remove(block);
+    foreach (Port* port, block->getPortList())
+        dirtyItems.remove(port);
+}
+
+void Scene::forgetPorts(Block* block)
+{
+    foreach (Port* port, block->getPortList()) {
+        connectedPorts.removeAll(port);
+        if (firstPort == port)
+            firstPort = 0;
+        if (secondPort == port)
+            secondPort = 0;
+    }
+}
+
+void Scene::unselectConnectedPorts()
+{
+    foreach (Port* port, connectedPorts) {
+        port->unselectPort();
+        markDirty(port);
+    }
+    connectedPorts.clear();
+}
+
+void Scene::setLastCalculated(Block* block)
+{
+    if (lastCalculated == block)
+        return;
+    markDirty(lastCalculated);
+    lastCalculated = block;
+    markDirty(lastCalculated);
+}
+
+bool Scene::startEditingAt(const QPointF &position)
+{
+    QGraphicsItem* item = itemAt(position, QTransform());
+    if (!item || item->type() != Block::Type)
+        return false;
+    Block* block = (Block*)item;
+    if (block->getBlockType() != Block::Input || !block->valueFieldRect().contains(block->mapFromScene(position)))
+        return false;
+    startEditing(block);
+    return true;
+}
+
+void Scene::startEditing(Block* block)
+{
+    if (!valueEditor) {
+        valueEditor = new QLineEdit();
+        valueEditor->setPlaceholderText("input");
+        valueEditor->setValidator(new QDoubleValidator(-1.79769e+308, 1.79769e+308, 50, valueEditor));
+        editorProxy = addWidget(valueEditor);
+        // Above the blocks, whose fields it covers
+        editorProxy->setZValue(1);
+        connect(valueEditor, SIGNAL(textChanged(QString)), this, SLOT(editorTextChanged(QString)));
+        connect(valueEditor, SIGNAL(editingFinished()), this, SLOT(finishEditing()));
     }
+
+    editedBlock = NULL;
+    valueEditor->setText(block->valueText());
+    editedBlock = block;
+    editorProxy->setGeometry(block->mapRectToScene(block->valueFieldRect()));
+    editorProxy->show();
+    editorProxy->setFocus();
+    valueEditor->setFocus();
+    valueEditor->selectAll();
+}
+
+void Scene::editorTextChanged(const QString &text)
+{
+    if (editedBlock)
+        editedBlock->setInputText(text);
+}
+
+void Scene::finishEditing()
+{
+    if (!editedBlock)
+        return;
+    // Cleared first, hiding the editor takes its focus and finishes the editing again
+    editedBlock = NULL;
+    editorProxy->hide();
 }
 
 void Scene::portUnselect(Port* first, Port* second)
 {
-    if (first) first->unselectPort();
-    if (second) second->unselectPort();
-    redrawScene();
+    if (first) {
+        first->unselectPort();
+        markDirty(first);
+    }
+    if (second) {
+        second->unselectPort();
+        markDirty(second);
+    }
 }
 
 int Scene::numberOfBlocks()
 {
-    return blockList.count();
+    return model.blockCount();
 }
 
 QList<Block*> Scene::getBlockList(){
     return blockList;
 }
 
-bool Scene::saveBlocksToFile(const QString &fileName)
+SchemeModel *Scene::schemeModel()
+{
+    return &model;
+}
+
+Block *Scene::getBlock(int id)
+{
+    return blockIndex.value(id, NULL);
+}
+
+void Scene::beginLoad()
 {
-    QFile file(fileName);
+    // Items are indexed all at once in endLoad()
+    setItemIndexMethod(QGraphicsScene::NoIndex);
+}
 
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning((QWidget*)parent(), "Unable to open file", file.errorString());
+Block* Scene::loadBlock(Block::blockType type, int id, int x, int y)
+{
+    // Also blocks which exist only in the model have their id taken
+    if (id < 0 || model.contains(id))
+        return NULL;
+    Block* block = new Block(type, this, QPoint(x, y), id);
+    addItem(block);
+    blockListAppend(block);
+    return block;
+}
+
+bool Scene::loadModelBlock(Block::blockType type, int id, int x, int y)
+{
+    // New blocks must not take the id while the block has no item
+    Block::reserveId(id);
+    invalidateCalcPlan();
+    return model.addBlock(SchemeModel::BlockType(type), id, x, y);
+}
+
+bool Scene::loadConnection(int fromId, int toId, int port)
+{
+    if (!model.connect(fromId, toId, port))
         return false;
-    }
+    invalidateCalcPlan();
 
-    QTextStream out(&file);
+    Block* block = getBlock(fromId);
+    Block* nextBlock = getBlock(toId);
+    if (block && nextBlock)
+        addConnectionLine(block->getOutPort(), nextBlock->getPort(port, Port::InPort));
+    return true;
+}
 
-    out << QString::fromStdString("<type> <id> <x> <y> <number_of_outputs> <<next_id><port>> <<next_id><port>> ...\n");
+bool Scene::loadRemoval(int id)
+{
+    Block* block = getBlock(id);
+    if (block) {
+        deleteBlock(block);
+        return true;
+    }
+    // A block without an item has no lines either, its tile skips it once it is gone
+    if (!model.contains(id))
+        return false;
+    model.removeBlock(id);
+    invalidateCalcPlan();
+    return true;
+}
 
-    foreach (Block* block, blockList) {
-        block->writeToStream(&out);
+bool Scene::loadMove(int id, int x, int y)
+{
+    Block* block = getBlock(id);
+    if (block) {
+        block->setPos(x, y);
+        return true;
+    }
+    if (!model.contains(id))
+        return false;
+    model.moveBlock(id, x, y);
+    // The old tile still lists the block, it is only created earlier than needed
+    pendingTiles[tileKey(qFloor(double(x) / tileSize), qFloor(double(y) / tileSize))].append(id);
+    return true;
+}
+
+bool Scene::loadDisconnection(int toId, int port)
+{
+    Block* block = getBlock(toId);
+    Port* inPort = block ? block->getPort(port, Port::InPort) : NULL;
+    if (inPort && inPort->hasLine()) {
+        QList<QGraphicsLineItem*> lines;
+        inPort->removeConnections(&lines);
+        deleteLine(lines.first());
+        return true;
     }
+    // The other block has no item, so the connection has no line
+    int slot = model.slotOf(toId);
+    if (slot < 0 || port < 0 || port >= SchemeModel::MaxInPorts || model.blockAt(slot).inEdges[port] < 0)
+        return false;
+    model.disconnect(toId, port);
+    invalidateCalcPlan();
+    return true;
+}
 
-    file.close();
+bool Scene::loadInputValue(int id, double value)
+{
+    int slot = model.slotOf(id);
+    if (slot < 0 || model.blockAt(slot).type != SchemeModel::Input)
+        return false;
+    // Nothing is recalculated during a bulk construction, the field only shows the value
+    model.setInputValue(id, value);
+    Block* block = getBlock(id);
+    if (block)
+        block->updateInputField();
     return true;
 }
 
-Block *Scene::getBlock(int id)
+void Scene::setTileSize(int size)
 {
-    foreach (Block* block, blockList) {
-        if (block->idBlock() == id)
-            return block;
+    tileSize = size;
+}
+
+qint64 Scene::tileKey(int column, int row) const
+{
+    return (qint64(column) << 32) | quint32(row);
+}
+
+void Scene::loadTile(int column, int row, const QVector<int> &ids)
+{
+    pendingTiles[tileKey(column, row)] += ids;
+}
+
+Block* Scene::materializeBlock(int id)
+{
+    Block* block = getBlock(id);
+    if (block)
+        return block;
+
+    const SchemeModel::BlockRecord& record = model.blockAt(model.slotOf(id));
+    QList<Block*>& pool = blockPool[record.type];
+    if (pool.isEmpty()) {
+        block = new Block(Block::blockType(record.type), this, QPoint(record.x, record.y), id);
     }
-    return NULL;
+    else {
+        // A released block of the same type has the right ports and fields already
+        block = pool.takeLast();
+        block->recycle(id, QPoint(record.x, record.y));
+    }
+    addItem(block);
+    blockList.append(block);
+    blockIndex.insert(id, block);
+    block->updateInputField();
+    block->updateOutputField();
+    return block;
+}
+
+void Scene::setVisibleArea(const QRectF &visible)
+{
+    // Items are created half a view around the visible part and released a whole view away from it,
+    // so scrolling back and forth does not recreate them
+    qreal width = visible.width();
+    qreal height = visible.height();
+    materialize(visible.adjusted(-width/2, -height/2, width/2, height/2));
+    if (virtualized)
+        release(visible.adjusted(-width, -height, width, height));
 }
 
-void Scene::loadConnections(QList<BlockInfo> loadList) {
-    foreach (BlockInfo entry, loadList) {
-        Port* firstPort = getBlock(entry.id)->getOutPort();
-        QPair<int,int> pair;
-        foreach (pair, entry.connections) {
-            Port* secondPort = getBlock(pair.first)->getPort(pair.second, Port::InPort);
-            createConnection(firstPort, secondPort);
+void Scene::setVirtualized(bool enabled)
+{
+    virtualized = enabled;
+}
+
+void Scene::materialize(const QRectF &area)
+{
+    QList<Block*> created;
+    bool tilesShown = false;
+
+    // Blocks of the tiles in the area
+    if (!pendingTiles.isEmpty()) {
+        int left = qFloor(area.left() / tileSize);
+        int right = qFloor(area.right() / tileSize);
+        int top = qFloor(area.top() / tileSize);
+        int bottom = qFloor(area.bottom() / tileSize);
+        QList<qint64> keys;
+        if (qint64(right - left + 1) * (bottom - top + 1) > pendingTiles.size()) {
+            // Zoomed far out, fewer tiles are left than there are in the area
+            for (QHash<qint64, QVector<int> >::const_iterator it = pendingTiles.constBegin();
+                 it != pendingTiles.constEnd(); ++it) {
+                int column = int(it.key() >> 32);
+                int row = int(qint32(quint32(it.key())));
+                if (column >= left && column <= right && row >= top && row <= bottom)
+                    keys.append(it.key());
+            }
         }
+        else {
+            for (int row = top; row <= bottom; row++) {
+                for (int column = left; column <= right; column++) {
+                    if (pendingTiles.contains(tileKey(column, row)))
+                        keys.append(tileKey(column, row));
+                }
+            }
+        }
+        tilesShown = !keys.isEmpty();
+        foreach (qint64 key, keys) {
+            foreach (int id, pendingTiles.take(key)) {
+                if (model.contains(id) && !getBlock(id))
+                    created.append(materializeBlock(id));
+            }
+        }
+    }
+
+    // Neighbours of all blocks in the area too, so every connection there has its line.
+    // Without a new tile or a released block, they all have their items already.
+    if (!tilesShown && !virtualized)
+        return;
+    foreach (QGraphicsItem* item, items(area)) {
+        if (item->type() != Block::Type)
+            continue;
+        const SchemeModel::BlockRecord& record = model.blockAt(model.slotOf(((Block*)item)->idBlock()));
+        for (int port = 0; port < SchemeModel::MaxInPorts; port++) {
+            if (record.inEdges[port] < 0)
+                continue;
+            int neighbour = model.blockAt(model.edgeAt(record.inEdges[port]).from).id;
+            if (!getBlock(neighbour))
+                created.append(materializeBlock(neighbour));
+        }
+        for (size_t j = 0; j < record.outEdges.size(); j++) {
+            int neighbour = model.blockAt(model.edgeAt(record.outEdges[j]).to).id;
+            if (!getBlock(neighbour))
+                created.append(materializeBlock(neighbour));
+        }
+    }
+
+    // Lines of the new blocks to all blocks that have an item, each input port has at most one
+    foreach (Block* block, created) {
+        const SchemeModel::BlockRecord& record = model.blockAt(model.slotOf(block->idBlock()));
+        for (int port = 0; port < SchemeModel::MaxInPorts; port++) {
+            if (record.inEdges[port] < 0)
+                continue;
+            Block* from = getBlock(model.blockAt(model.edgeAt(record.inEdges[port]).from).id);
+            Port* inPort = block->getPort(port, Port::InPort);
+            if (from && !inPort->hasLine())
+                addConnectionLine(from->getOutPort(), inPort);
+        }
+        for (size_t j = 0; j < record.outEdges.size(); j++) {
+            const SchemeModel::Edge& edge = model.edgeAt(record.outEdges[j]);
+            Block* to = getBlock(model.blockAt(edge.to).id);
+            Port* inPort = to ? to->getPort(edge.toPort, Port::InPort) : NULL;
+            if (inPort && !inPort->hasLine())
+                addConnectionLine(block->getOutPort(), inPort);
+        }
+    }
+}
+
+void Scene::release(const QRectF &area)
+{
+    // Blocks in the area keep their items, and so do their neighbours, which draw their lines
+    QSet<Block*> kept;
+    foreach (QGraphicsItem* item, items(area)) {
+        if (item->type() != Block::Type)
+            continue;
+        Block* block = (Block*)item;
+        kept.insert(block);
+        foreach (Block* neighbour, block->getNextBlocks())
+            kept.insert(neighbour);
+        foreach (Port* port, block->getInPortList()) {
+            foreach (Block* previous, port->getNextBlocks())
+                kept.insert(previous);
+        }
+    }
+    // The user may still work with selected blocks and the port chosen for a connection
+    foreach (QGraphicsItem* item, selectedItems()) {
+        if (item->type() == Block::Type)
+            kept.insert((Block*)item);
+    }
+    if (firstPort)
+        kept.insert(firstPort->parentBlock());
+    if (kept.size() == blockList.size())
+        return;
+
+    QList<Block*> remaining;
+    remaining.reserve(kept.size());
+    foreach (Block* block, blockList) {
+        if (kept.contains(block))
+            remaining.append(block);
+        else
+            releaseBlock(block);
+    }
+    blockList = remaining;
+    trimPools();
+}
+
+void Scene::trimPools()
+{
+    // Scrolling back needs about as many items as are near the view, more would only hold memory
+    // Pooled blocks were taken off connectedPorts when they were released, deleting them is safe
+    int blockLimit = PoolFactor * blockList.size();
+    for (QHash<int, QList<Block*> >::iterator it = blockPool.begin(); it != blockPool.end(); ++it) {
+        while (it->size() > blockLimit)
+            delete it->takeLast();
+    }
+    int lineLimit = PoolFactor * lineSet.size();
+    while (linePool.size() > lineLimit)
+        delete linePool.takeLast();
+}
+
+void Scene::releaseBlock(Block* block)
+{
+    // The connections stay in the model, only their lines go away
+    QList<QGraphicsLineItem*> lines;
+    foreach (Port* port, block->getPortList())
+        port->removeConnections(&lines);
+    foreach (QGraphicsLineItem* item, lines) {
+        Line* line = (Line*)item;
+        line->getStartPort()->removeConnection(line);
+        line->getEndPort()->removeConnection(line);
+        takeLine(line);
+        linePool.append(line);
+    }
+
+    block->setSelected(false);
+    forgetDirty(block);
+    forgetPorts(block);
+    if (editedBlock == block)
+        finishEditing();
+    removeItem(block);
+    blockIndex.remove(block->idBlock());
+    if (lastCalculated == block)
+        lastCalculated = NULL;
+
+    const SchemeModel::BlockRecord& record = model.blockAt(model.slotOf(block->idBlock()));
+    pendingTiles[tileKey(qFloor(double(record.x) / tileSize), qFloor(double(record.y) / tileSize))]
+            .append(record.id);
+    blockPool[block->getBlockType()].append(block);
+}
+
+void Scene::endLoad()
+{
+    // The view has to be able to scroll to blocks that have no item yet
+    QRectF bounds = sceneRect();
+    for (QHash<qint64, QVector<int> >::const_iterator it = pendingTiles.constBegin();
+         it != pendingTiles.constEnd(); ++it) {
+        int column = int(it.key() >> 32);
+        int row = int(qint32(quint32(it.key())));
+        bounds |= QRectF(column * tileSize, row * tileSize, tileSize, tileSize);
+    }
+    setSceneRect(bounds);
+
+    setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+    if (liveUpdate) {
+        std::vector<int> changed;
+        SchemeModel::EvalError err = model.recalculateAll(&changed);
+        showRecalculated(changed, err);
     }
+    update();
 }
@@ -22,12 +22,19 @@
 #include <QKeyEvent>
 #include <QDebug>
 #include <QLineEdit>
+#include <QDoubleValidator>
+#include <QGraphicsProxyWidget>
 #include <QStatusBar>
 #include <QTimer>
 #include <QTextStream>
+#include <QVector>
+#include <QHash>
+#include <QSet>
 #include "port.h"
 #include "block.h"
 #include "line.h"
+#include "edgelayer.h"
+#include "schememodel.h"
 
 /**
  * @brief The Scene class contains the information about what is on the scene.
@@ -36,26 +43,27 @@ class Scene : public QGraphicsScene
 {
     Q_OBJECT
 public:
-    /**
-     * @brief The BlockInfo struct contains all information needed to recreate a block.
-     * It is used to load data from save file.
-     */
-    struct BlockInfo {
-        Block::blockType type;
-        int id;
-        int x;
-        int y;
-        QList<QPair<int, int>> connections;
-    };
     /**
      * @brief The Mode enum contains a set of scene's modes.
      */
     enum Mode {NoMode, SelectObject, DrawLine};
+    /**
+     * @brief SnapRadius is the largest distance of a click from the center of a port which picks the port.
+     */
+    static const int SnapRadius = 12;
+    /**
+     * @brief PoolFactor is how many released items of a kind are kept for reuse per item of that kind in the scene.
+     */
+    static const int PoolFactor = 2;
     /**
      * @brief Scene is a constructor.
      * @param parent is a pointer to object.
      */
     Scene(QObject* parent = 0);
+    /**
+     * @brief ~Scene deletes the pooled items, which are not in the scene.
+     */
+    ~Scene();
     /**
      * @brief setMode sets mode of a scene.
      * @param mode is a mode of a scene.
@@ -83,9 +91,10 @@ public:
     void addItem(Block* block);
     /**
      * @brief containsLoops checks if the scheme contains loops.
+     * @param loop If given and a loop is found, filled with the blocks forming the loop.
      * @return bool value. True is if the scheme contains loops, otherwise is a False.
      */
-    bool containsLoops();
+    bool containsLoops(QList<Block*>* loop = NULL);
     /**
      * @brief allInputPortsConnected checks if all Input Ports are connected.
      * @return bool value. True is all InPort are connected, otherwise it is False.
@@ -125,9 +134,17 @@ public:
      */
     void setCalcComplete();
     /**
-     * @brief redrawScene Schedules the redraw for all objects on the scene.
+     * @brief markDirty Schedules the redraw of an item whose look has changed.
+     * All items marked during one turn of the event loop are redrawn together, each of them once.
+     * @param item Item of the scene, NULL is ignored.
      */
-    void redrawScene();
+    void markDirty(QGraphicsItem* item);
+    /**
+     * @brief blockMoved schedules the update of the lines of a moved block.
+     * The lines of all blocks moved by one drag step are updated together, each of them once.
+     * @param block Block with a new position.
+     */
+    void blockMoved(Block* block);
     /**
      * @brief deleteAll deletes everything on the scene.
      */
@@ -138,13 +155,7 @@ public:
      */
     QList<Block* >getBlockList();
     /**
-     * @brief saveBlocksToFile Writes blocks data to a given file.
-     * @param fileName Full path to the file obtained with method QFileDialog::getSaveFileName().
-     * @return Returns true if operation was succesful, false otherwise.
-     */
-    bool saveBlocksToFile(const QString &fileName);
-    /**
-     * @brief getBlock Finds a block with a given id.
+     * @brief getBlock Finds a block with a given id in constant time.
      * @param id An id to identify a block.
      * @return Block with given id if found, NULL otherwise.
      */
@@ -153,13 +164,121 @@ public:
      * @brief createConnection Creates a connection between two given ports.
      * @param first First port (output)
      * @param second Second port (input)
+     * @return Returns false if the model refuses the connection, e.g. because it would create a loop, true otherwise.
+     */
+    bool createConnection(Port* first = NULL, Port* second = NULL);
+    /**
+     * @brief beginLoad Starts a bulk construction of the scene, e.g. from a file.
+     * Until endLoad() is called, the items are not indexed and nothing is redrawn or recalculated.
+     */
+    void beginLoad();
+    /**
+     * @brief loadBlock Creates a block as a part of a bulk construction.
+     * @param type Type of the block.
+     * @param id Id of the block.
+     * @param x X position of the block.
+     * @param y Y position of the block.
+     * @return The new block, NULL if the id is negative or already in use.
+     */
+    Block* loadBlock(Block::blockType type, int id, int x, int y);
+    /**
+     * @brief loadModelBlock Adds a block only to the model as a part of a bulk construction.
+     * Its item is created by materialize() once its tile is in view, see loadTile().
+     * @param type Type of the block.
+     * @param id Id of the block.
+     * @param x X position of the block.
+     * @param y Y position of the block.
+     * @return Returns false if the id is already in use.
+     */
+    bool loadModelBlock(Block::blockType type, int id, int x, int y);
+    /**
+     * @brief loadConnection Creates a connection as a part of a bulk construction.
+     * The line is only created if both blocks have their items.
+     * @param fromId Id of the block whose output is connected.
+     * @param toId Id of the block whose input is connected.
+     * @param port Number of the input port.
+     * @return Returns false if a block or port does not exist, the port is taken or the connection forms a loop.
+     */
+    bool loadConnection(int fromId, int toId, int port);
+    /**
+     * @brief setTileSize Sets the size of the tiles passed to loadTile().
+     * @param size Width and height of a tile.
+     */
+    void setTileSize(int size);
+    /**
+     * @brief loadTile Registers blocks of the model whose items are created when the tile comes into view.
+     * @param column Column of the tile, the tile starts at x = column * tile size.
+     * @param row Row of the tile, the tile starts at y = row * tile size.
+     * @param ids Ids of the blocks in the tile.
+     */
+    void loadTile(int column, int row, const QVector<int> &ids);
+    /**
+     * @brief setVisibleArea Creates the items of blocks around the visible part of the scene which have none yet.
+     * In the virtualized mode, it also releases the items far from it.
+     * @param visible Part of the scene shown by the view.
+     */
+    void setVisibleArea(const QRectF &visible);
+    /**
+     * @brief setVirtualized turns on or off the virtualized mode. In this mode, only blocks near the visible
+     * part of the scene have items, the items of the others are returned to a pool and reused.
+     * The model always holds the whole scheme.
+     * @param enabled True to keep items only near the visible part.
+     */
+    void setVirtualized(bool enabled);
+    /**
+     * @brief setEdgeLayer turns on or off drawing of all connections by one EdgeLayer item.
+     * With the layer, lines are not items of the scene and are selected by a click only.
+     * @param enabled True to draw the connections by the layer.
+     */
+    void setEdgeLayer(bool enabled);
+    /**
+     * @brief loadRemoval Deletes a block as a part of a bulk construction, e.g. when replaying a journal.
+     * @param id Id of the block.
+     * @return Returns false if the block does not exist.
+     */
+    bool loadRemoval(int id);
+    /**
+     * @brief loadMove Moves a block as a part of a bulk construction.
+     * @param id Id of the block.
+     * @param x New x position.
+     * @param y New y position.
+     * @return Returns false if the block does not exist.
+     */
+    bool loadMove(int id, int x, int y);
+    /**
+     * @brief loadDisconnection Deletes the connection ending in an input port as a part of a bulk construction.
+     * @param toId Id of the block whose input is connected.
+     * @param port Number of the input port.
+     * @return Returns false if the port does not exist or is not connected.
+     */
+    bool loadDisconnection(int toId, int port);
+    /**
+     * @brief loadInputValue Sets the value of an Input block as a part of a bulk construction.
+     * @param id Id of the block.
+     * @param value New value.
+     * @return Returns false if the block does not exist or is not an Input block.
+     */
+    bool loadInputValue(int id, double value);
+    /**
+     * @brief endLoad Finishes a bulk construction, indexes the items and redraws the scene once.
+     */
+    void endLoad();
+    /**
+     * @brief schemeModel returns the headless model mirrored by the scene.
+     * @return the model of the scheme.
+     */
+    SchemeModel* schemeModel();
+    /**
+     * @brief setLiveUpdate turns on or off recalculation of the scheme whenever an input value changes.
+     * @param enabled True to recalculate on every change.
      */
-    void createConnection(Port* first = NULL, Port* second = NULL);
+    void setLiveUpdate(bool enabled);
     /**
-     * @brief loadConnections Creates connections from information from a save file.
-     * @param loadList A list of strucutures BlockInfo containing information about blocks in the scene.
+     * @brief inputValueChanged recalculates the blocks downstream of a block whose value was changed.
+     * Does nothing unless live update is on.
+     * @param block Block with the new value.
      */
-    void loadConnections(QList<BlockInfo> loadList);
+    void inputValueChanged(Block* block);
 public slots:
     /**
      * @brief portUnselect Unselects the selected ports.
@@ -167,12 +286,40 @@ public slots:
      * @param second Second selected port.
      */
     void portUnselect(Port* first, Port* second);
+private slots:
+    /**
+     * @brief repaintDirty Redraws the items marked by markDirty().
+     */
+    void repaintDirty();
+    /**
+     * @brief unselectConnectedPorts Unselects the ports of the connections created lately.
+     */
+    void unselectConnectedPorts();
+    /**
+     * @brief editorTextChanged passes the text of the value editor to the edited block.
+     * @param text New text.
+     */
+    void editorTextChanged(const QString &text);
+    /**
+     * @brief finishEditing hides the value editor.
+     */
+    void finishEditing();
 protected:
     /**
      * @brief mousePressEvent do actions if mouse button is pressed.
      * @param event is a mouse event.
      */
     void mousePressEvent(QGraphicsSceneMouseEvent *event);
+    /**
+     * @brief mouseMoveEvent drags the selected blocks and moves their lines.
+     * @param event is a mouse event.
+     */
+    void mouseMoveEvent(QGraphicsSceneMouseEvent *event);
+    /**
+     * @brief mouseDoubleClickEvent passes a double click to the items only in the select mode.
+     * @param event is a mouse event.
+     */
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event);
     /**
      * @brief keyPressEvent Executes actions when a keyborad key is pressed.
      * @param event is a key event.
@@ -180,23 +327,60 @@ protected:
     void keyPressEvent(QKeyEvent *event);
 private:
     Mode sceneMode;
+    SchemeModel model; /**< Graph and values of the scheme, the items only display it.*/
     QList<Block*> blockList;
-    QList<Block*> toCalculate;
+    QHash<int, Block*> blockIndex; /**< Blocks of blockList by their id.*/
+    QSet<Line*> lineSet; /**< All connections of the scene, each line knows its two ports.*/
+    QVector<int> calcPlan; /**< Slots of blocks in the order of evaluation.*/
+    int calcPlanPos; /**< Index of the next block of calcPlan to calculate.*/
     Port* firstPort;
     Port* secondPort;
     bool calculationComplete;
     Block* lastCalculated;
+    bool liveUpdate; /**< Whether changes are recalculated right away.*/
+    int tileSize; /**< Size of the tiles of pendingTiles.*/
+    QHash<qint64, QVector<int> > pendingTiles; /**< Ids of blocks without items, by tile.*/
+    bool virtualized; /**< Whether items far from the view are released.*/
+    QHash<int, QList<Block*> > blockPool; /**< Released blocks by their type, ready to be reused.*/
+    QList<Line*> linePool; /**< Released lines, ready to be reused.*/
+    QSet<QGraphicsItem*> dirtyItems; /**< Items to be redrawn by repaintDirty().*/
+    QSet<Block*> movedBlocks; /**< Blocks whose lines are moved by updateMovedLines().*/
+    QTimer* repaintTimer; /**< Runs repaintDirty() once the event loop is idle.*/
+    QList<Port*> connectedPorts; /**< Ports of new connections, unselected by unselectConnectedPorts().*/
+    QTimer* unselectTimer; /**< Runs unselectConnectedPorts() a moment after the last new connection.*/
+    QLineEdit* valueEditor; /**< The one editor shared by all input blocks, created on first use.*/
+    QGraphicsProxyWidget* editorProxy; /**< Places valueEditor over the field of editedBlock.*/
+    Block* editedBlock; /**< Input block being edited, NULL if none.*/
+    EdgeLayer* edgeLayer; /**< Draws all lines when set, they are not in the scene then.*/
 
-    QList<Port*> getScenePorts();
-    void makeItemsControllable(bool areControllable);
+    Port* portAt(const QPointF &position);
+    bool itemsControllable(const QPointF &position);
     void deleteSelectedItems();
-    void deleteLine(QGraphicsLineItem* line);
-    void deleteBlock(Block* block);
+    void deleteLine(QGraphicsLineItem* item);
+    void deleteBlock(Block* block, bool removeFromList = true);
     QString selectedPorts();
-    void getClickedFirstPort();
-    void getClickedSecondPort();
-    void calculateHelperFunc(Block::calcError* err, Block* block);
-    Line* addLine(const QLineF &line);
+    void getClickedFirstPort(const QPointF &position);
+    void getClickedSecondPort(const QPointF &position);
+    void calculateHelperFunc(Block::calcError* err, int slot);
+    bool buildCalcPlan();
+    void invalidateCalcPlan();
+    void showRecalculated(const std::vector<int>& changed, SchemeModel::EvalError err);
+    Line* connectPorts(Port* outPort, Port* inPort, SchemeModel::ConnectError* error = NULL);
+    Line* addLine(const QLineF &line, Port* startPort, Port* endPort);
+    Line* addConnectionLine(Port* outPort, Port* inPort);
+    void takeLine(Line* line);
+    Block* materializeBlock(int id);
+    void materialize(const QRectF &area);
+    void release(const QRectF &area);
+    void releaseBlock(Block* block);
+    void trimPools();
+    qint64 tileKey(int column, int row) const;
+    void forgetDirty(Block* block);
+    void forgetPorts(Block* block);
+    void updateMovedLines();
+    void setLastCalculated(Block* block);
+    void startEditing(Block* block);
+    bool startEditingAt(const QPointF &position);
 };
 
 #endif // SCENE_H
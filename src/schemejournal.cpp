@@ -0,0 +1,258 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the journal of edits.
+ * @file schemejournal.cpp
+ *
+ *
+ */
+
+#include "schemejournal.h"
+#include "scene.h"
+
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+
+const char SchemeJournal::Magic[8] = { 'B', 'E', 'J', 'O', 'U', 'R', 'N', 'L' };
+
+static const int HeaderSize = 12;
+
+static void appendInt(QByteArray* buffer, qint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian<qint32>(value, bytes);
+    buffer->append((const char*)bytes, 4);
+}
+
+SchemeJournal::SchemeJournal(const SchemeModel* model)
+{
+    this->model = model;
+    droppedBytes = 0;
+}
+
+QString SchemeJournal::fileName(const QString &schemeFile)
+{
+    return schemeFile + ".journal";
+}
+
+bool SchemeJournal::hasEdits() const
+{
+    return !records.isEmpty() || !movedBlocks.isEmpty() || !changedInputs.isEmpty();
+}
+
+void SchemeJournal::appendRecord(Operation operation, int count, const int* arguments)
+{
+    records.append(char(operation));
+    for (int i = 0; i < count; i++)
+        appendInt(&records, arguments[i]);
+}
+
+void SchemeJournal::blockAdded(const SchemeModel::BlockRecord& block)
+{
+    int arguments[] = { block.type, block.id, block.x, block.y };
+    appendRecord(AddBlock, 4, arguments);
+    // The record already has the position
+    movedBlocks.remove(block.id);
+}
+
+void SchemeJournal::blockRemoved(int id)
+{
+    appendRecord(RemoveBlock, 1, &id);
+    movedBlocks.remove(id);
+    changedInputs.remove(id);
+}
+
+void SchemeJournal::blockMoved(int id)
+{
+    // A drag moves a block many times, only the last position is saved
+    movedBlocks.insert(id);
+}
+
+void SchemeJournal::connected(int fromId, int toId, int toPort)
+{
+    int arguments[] = { fromId, toId, toPort };
+    appendRecord(Connect, 3, arguments);
+}
+
+void SchemeJournal::disconnected(int toId, int toPort)
+{
+    int arguments[] = { toId, toPort };
+    appendRecord(Disconnect, 2, arguments);
+}
+
+void SchemeJournal::inputValueChanged(int id)
+{
+    // Typing changes a value many times, only the last one is saved
+    changedInputs.insert(id);
+}
+
+void SchemeJournal::cleared()
+{
+    // Nothing recorded before matters any more
+    discard();
+    appendRecord(Clear, 0, NULL);
+}
+
+void SchemeJournal::discard()
+{
+    droppedBytes += records.size();
+    records.clear();
+    movedBlocks.clear();
+    changedInputs.clear();
+}
+
+qint64 SchemeJournal::mark() const
+{
+    return droppedBytes + records.size();
+}
+
+void SchemeJournal::dropUntil(qint64 mark)
+{
+    // Records before the mark may have been forgotten already, e.g. by clearing the scheme
+    qint64 count = mark - droppedBytes;
+    if (count <= 0)
+        return;
+    records.remove(0, int(count));
+    droppedBytes += count;
+}
+
+bool SchemeJournal::save(const QString &fileName, QString* error)
+{
+    // Last positions and values come after the structural edits, the blocks exist by then
+    QByteArray buffer = records;
+    foreach (int id, movedBlocks) {
+        int slot = model->slotOf(id);
+        if (slot < 0)
+            continue;
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        buffer.append(char(MoveBlock));
+        appendInt(&buffer, id);
+        appendInt(&buffer, block.x);
+        appendInt(&buffer, block.y);
+    }
+    foreach (int id, changedInputs) {
+        int slot = model->slotOf(id);
+        if (slot < 0 || !model->blockAt(slot).inputSet)
+            continue;
+        double value = model->blockAt(slot).inputValue;
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uchar bytes[8];
+        qToLittleEndian<quint64>(bits, bytes);
+        buffer.append(char(SetInput));
+        appendInt(&buffer, id);
+        buffer.append((const char*)bytes, 8);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        *error = file.errorString();
+        return false;
+    }
+    if (file.size() == 0) {
+        QByteArray header(Magic, sizeof(Magic));
+        appendInt(&header, Version);
+        buffer.prepend(header);
+    }
+    if (file.write(buffer) != buffer.size()) {
+        *error = file.errorString();
+        return false;
+    }
+    file.close();
+    discard();
+    return true;
+}
+
+bool SchemeJournal::replay(const QString &fileName, Scene* scene, QString* error)
+{
+    QFile file(fileName);
+    if (!file.exists())
+        return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    QByteArray journal = file.readAll();
+    const uchar* data = (const uchar*)journal.constData();
+    int size = journal.size();
+
+    if (size < HeaderSize || memcmp(data, Magic, sizeof(Magic)) != 0) {
+        *error = "The journal is not valid.";
+        return false;
+    }
+    quint32 version = qFromLittleEndian<quint32>(data + sizeof(Magic));
+    if (version != Version) {
+        *error = QString("Unsupported journal version %1.").arg(version);
+        return false;
+    }
+
+    int position = HeaderSize;
+    for (int record = 1; position < size; record++) {
+        int operation = data[position++];
+        int count;
+        switch (operation) {
+        case AddBlock: count = 4; break;
+        case RemoveBlock: count = 1; break;
+        case MoveBlock: count = 3; break;
+        case Connect: count = 3; break;
+        case Disconnect: count = 2; break;
+        case SetInput: count = 3; break; // id and a double
+        case Clear: count = 0; break;
+        default:
+            *error = QString("Journal record %1: unknown operation %2.").arg(record).arg(operation);
+            return false;
+        }
+        if (size - position < 4*count) {
+            *error = QString("Journal record %1: the journal is truncated.").arg(record);
+            return false;
+        }
+        qint32 arguments[4];
+        for (int i = 0; i < count && i < 4; i++)
+            arguments[i] = qFromLittleEndian<qint32>(data + position + 4*i);
+
+        bool applied = true;
+        switch (operation) {
+        case AddBlock:
+            // A block of a partially loaded scheme may exist only in the model
+            if (arguments[0] < Block::Add || arguments[0] > Block::Output
+                    || scene->schemeModel()->contains(arguments[1]))
+                applied = false;
+            else
+                applied = scene->loadBlock(Block::blockType(arguments[0]), arguments[1], arguments[2], arguments[3]) != NULL;
+            break;
+        case RemoveBlock:
+            applied = scene->loadRemoval(arguments[0]);
+            break;
+        case MoveBlock:
+            applied = scene->loadMove(arguments[0], arguments[1], arguments[2]);
+            break;
+        case Connect:
+            applied = scene->loadConnection(arguments[0], arguments[1], arguments[2]);
+            break;
+        case Disconnect:
+            applied = scene->loadDisconnection(arguments[0], arguments[1]);
+            break;
+        case SetInput: {
+            quint64 bits = qFromLittleEndian<quint64>(data + position + 4);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            applied = scene->loadInputValue(arguments[0], value);
+            break;
+        }
+        case Clear:
+            scene->deleteAll();
+            break;
+        }
+        if (!applied) {
+            *error = QString("Journal record %1: the edit does not fit the scheme.").arg(record);
+            return false;
+        }
+        position += 4*count;
+    }
+    return true;
+}
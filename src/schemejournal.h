@@ -0,0 +1,116 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Journal of edits saved next to a scheme file.
+ * @file schemejournal.h
+ *
+ *
+ */
+
+#ifndef SCHEMEJOURNAL_H
+#define SCHEMEJOURNAL_H
+
+#include <QByteArray>
+#include <QSet>
+#include <QString>
+#include "schememodel.h"
+
+class Scene;
+
+/**
+ * @brief The SchemeJournal class records edits of a scheme and appends them to a journal file next to the scheme file.
+ *
+ * Saving a journal costs only the edits made since the last save, the scheme file itself is not rewritten.
+ * Opening a scheme replays its journal on top of it. Compacting the scheme, i.e. saving it whole, makes
+ * the journal unnecessary.
+ *
+ * The journal file starts with the magic "BEJOURNL" and the version (little-endian 32-bit integer).
+ * Each record is an operation byte followed by its arguments as little-endian 32-bit integers.
+ * Moves are not stored one by one, a save stores only the last position of each moved block.
+ * Values of Input blocks are saved the same way, a SetInput record holds the id and a little-endian IEEE double.
+ */
+class SchemeJournal : public SchemeModel::Listener
+{
+public:
+    /**
+     * @brief The Operation enum contains the types of journal records.
+     */
+    enum Operation { AddBlock = 1, RemoveBlock, MoveBlock, Connect, Disconnect, SetInput, Clear };
+    /**
+     * @brief Magic bytes at the beginning of every journal file.
+     */
+    static const char Magic[8];
+    /**
+     * @brief Version of the journal format.
+     */
+    static const quint32 Version = 1;
+
+    /**
+     * @brief SchemeJournal is the constructor.
+     * @param model Model whose edits are recorded, the journal has to be set as its listener.
+     */
+    SchemeJournal(const SchemeModel* model);
+    /**
+     * @brief fileName returns the name of the journal belonging to a scheme file.
+     * @param schemeFile Full path to the scheme file.
+     * @return Full path to the journal.
+     */
+    static QString fileName(const QString &schemeFile);
+    /**
+     * @brief hasEdits checks if there are edits not saved yet.
+     * @return true if a save would write something.
+     */
+    bool hasEdits() const;
+    /**
+     * @brief save appends the edits made since the last save to a journal file.
+     * @param fileName Full path to the journal.
+     * @param error Description of the problem if the journal cannot be written.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    bool save(const QString &fileName, QString* error);
+    /**
+     * @brief discard forgets the recorded edits, e.g. when the whole scheme is saved.
+     */
+    void discard();
+    /**
+     * @brief mark returns the position after the edits recorded so far, e.g. when a snapshot of the scheme is taken.
+     * @return position in the journal.
+     */
+    qint64 mark() const;
+    /**
+     * @brief dropUntil forgets the edits recorded before a mark, e.g. when a snapshot taken there was saved whole.
+     * Later edits are kept. Positions are kept too, saving them again changes nothing.
+     * @param mark Position returned by mark().
+     */
+    void dropUntil(qint64 mark);
+    /**
+     * @brief replay applies a journal to a scene which contains the scheme it belongs to.
+     * @param fileName Full path to the journal. A journal that does not exist is empty.
+     * @param scene Scene with the scheme, the caller surrounds the call with beginLoad() and endLoad().
+     * @param error Description of the problem if the journal cannot be read.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    static bool replay(const QString &fileName, Scene* scene, QString* error);
+
+    void blockAdded(const SchemeModel::BlockRecord& block);
+    void blockRemoved(int id);
+    void blockMoved(int id);
+    void connected(int fromId, int toId, int toPort);
+    void disconnected(int toId, int toPort);
+    void inputValueChanged(int id);
+    void cleared();
+private:
+    const SchemeModel* model; /**< model whose edits are recorded.*/
+    QByteArray records; /**< records of the structural edits in the order they happened.*/
+    qint64 droppedBytes; /**< bytes of records forgotten so far, so marks stay valid.*/
+    QSet<int> movedBlocks; /**< blocks moved since the last save.*/
+    QSet<int> changedInputs; /**< Input blocks whose value was set since the last save.*/
+
+    void appendRecord(Operation operation, int count, const int* arguments);
+};
+
+#endif // SCHEMEJOURNAL_H
@@ -0,0 +1,258 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the text scheme parser.
+ * @file schemereader.cpp
+ *
+ *
+ */
+
+#include "schemereader.h"
+#include "scene.h"
+#include "compresseddevice.h"
+
+#include <QFile>
+#include <climits>
+
+SchemeReader::SchemeReader(QIODevice* device)
+{
+    this->device = device;
+    length = 0;
+    position = 0;
+    line = 1;
+    column = 1;
+    readFailed = false;
+    skippedConnections = 0;
+}
+
+bool SchemeReader::read(const QString &fileName, Scene* scene, QString* error, QString* warning)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    CompressedDevice decompressor(&file);
+    QIODevice* device = &file;
+    if (CompressedDevice::isCompressed(&file)) {
+        if (!decompressor.open(QIODevice::ReadOnly)) {
+            *error = decompressor.errorString();
+            return false;
+        }
+        device = &decompressor;
+    }
+
+    SchemeReader reader(device);
+    if (!reader.read(scene)) {
+        *error = reader.errorString();
+        return false;
+    }
+    if (warning)
+        *warning = reader.warningString();
+    return true;
+}
+
+QString SchemeReader::errorString() const
+{
+    return error;
+}
+
+QString SchemeReader::warningString() const
+{
+    return warning;
+}
+
+int SchemeReader::peek()
+{
+    if (position == length) {
+        qint64 count = device->read(buffer, BufferSize);
+        length = count > 0 ? int(count) : 0;
+        if (count < 0)
+            readFailed = true;
+        position = 0;
+        if (length == 0)
+            return -1;
+    }
+    return (unsigned char)buffer[position];
+}
+
+void SchemeReader::advance()
+{
+    if (buffer[position] == '\n') {
+        line++;
+        column = 1;
+    }
+    else {
+        column++;
+    }
+    position++;
+}
+
+void SchemeReader::skipSpaces()
+{
+    int c = peek();
+    while (c == ' ' || c == '\t' || c == '\r') {
+        advance();
+        c = peek();
+    }
+}
+
+void SchemeReader::skipLine()
+{
+    int c = peek();
+    while (c != -1 && c != '\n') {
+        advance();
+        c = peek();
+    }
+    if (c == '\n')
+        advance();
+}
+
+bool SchemeReader::readInt(int* value, const char* what)
+{
+    skipSpaces();
+    int c = peek();
+    bool negative = false;
+    if (c == '-') {
+        negative = true;
+        advance();
+        c = peek();
+    }
+    if (c < '0' || c > '9')
+        return fail(QString("expected %1").arg(what));
+
+    qint64 number = 0;
+    while (c >= '0' && c <= '9') {
+        number = number * 10 + (c - '0');
+        if (number > INT_MAX)
+            return fail(QString("%1 is too large").arg(what));
+        advance();
+        c = peek();
+    }
+    if (c != -1 && c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        return fail(QString("unexpected character '%1'").arg(QChar(c)));
+
+    *value = int(negative ? -number : number);
+    return true;
+}
+
+bool SchemeReader::readDouble(double* value, const char* what)
+{
+    skipSpaces();
+    // Doubles are rare in the file, so they are collected and left to Qt
+    QByteArray text;
+    int c = peek();
+    while (c != -1 && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        text.append(char(c));
+        advance();
+        c = peek();
+    }
+    bool ok;
+    *value = text.toDouble(&ok);
+    if (!ok)
+        return fail(QString("expected %1").arg(what));
+    return true;
+}
+
+bool SchemeReader::fail(const QString &message)
+{
+    // A broken device is the cause of any parse error that follows
+    if (readFailed) {
+        error = device->errorString();
+        return false;
+    }
+    error = QString("Line %1, column %2: %3.").arg(line).arg(column).arg(message);
+    return false;
+}
+
+bool SchemeReader::fail(int atLine, const QString &message)
+{
+    if (readFailed) {
+        error = device->errorString();
+        return false;
+    }
+    error = QString("Line %1: %2.").arg(atLine).arg(message);
+    return false;
+}
+
+bool SchemeReader::read(Scene* scene)
+{
+    // The first line only describes the format
+    skipLine();
+
+    for (;;) {
+        skipSpaces();
+        int c = peek();
+        if (c == -1)
+            break;
+        if (c == '\n') {
+            advance();
+            continue;
+        }
+
+        int blockLine = line;
+        int type, id, x, y, count;
+        if (!readInt(&type, "block type") || !readInt(&id, "block id") ||
+            !readInt(&x, "x position") || !readInt(&y, "y position") ||
+            !readInt(&count, "number of connections"))
+            return false;
+        if (type < Block::Add || type > Block::Output)
+            return fail(blockLine, QString("unknown block type %1").arg(type));
+        if (id < 0 || scene->schemeModel()->contains(id))
+            return fail(blockLine, QString("invalid or repeated block id %1").arg(id));
+        if (count < 0)
+            return fail(blockLine, "negative number of connections");
+
+        for (int i = 0; i < count; i++) {
+            Connection connection;
+            connection.fromId = id;
+            connection.line = blockLine;
+            if (!readInt(&connection.toId, "id of the next block") ||
+                !readInt(&connection.port, "port of the next block"))
+                return false;
+            connections.append(connection);
+        }
+
+        bool valueSet = false;
+        double value = 0;
+        skipSpaces();
+        c = peek();
+        if (c == '=' && type == Block::Input) {
+            advance();
+            if (!readDouble(&value, "value of the input"))
+                return false;
+            valueSet = true;
+            skipSpaces();
+            c = peek();
+        }
+        if (c != -1 && c != '\n')
+            return fail("more numbers than connections");
+
+        if (!scene->loadBlock(Block::blockType(type), id, x, y))
+            return fail(blockLine, QString("invalid or repeated block id %1").arg(id));
+        if (valueSet)
+            scene->loadInputValue(id, value);
+    }
+
+    // Older versions saved loops and taken ports too, such connections are left out
+    for (int i = 0; i < connections.size(); i++) {
+        const Connection &connection = connections.at(i);
+        if (scene->loadConnection(connection.fromId, connection.toId, connection.port))
+            continue;
+        if (skippedConnections++ == 0)
+            warning = QString("Line %1: invalid connection to block %2, port %3")
+                      .arg(connection.line).arg(connection.toId).arg(connection.port);
+    }
+    if (skippedConnections > 0)
+        warning = QString("%1 connection(s) were left out because they form a loop, connect a taken port "
+                          "or a missing block. %2.").arg(skippedConnections).arg(warning);
+    if (readFailed) {
+        error = device->errorString();
+        return false;
+    }
+    return true;
+}
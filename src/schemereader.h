@@ -0,0 +1,106 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Streaming parser of the text format of a scheme file.
+ * @file schemereader.h
+ *
+ *
+ */
+
+#ifndef SCHEMEREADER_H
+#define SCHEMEREADER_H
+
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+class Scene;
+
+/**
+ * @brief The SchemeReader class parses the text format of a scheme file.
+ *
+ * The first line of the file is a comment. Every other line describes one block:
+ * type, id, x, y, number of connections and a pair (id of the next block, input port)
+ * for each connection. An Input block with a value ends its line with '=' followed by the value.
+ * Empty lines are skipped.
+ *
+ * The device is read in chunks into a fixed buffer and the numbers are parsed from the bytes
+ * directly. Blocks are passed to the bulk construction path of the scene as soon as their line
+ * is parsed. Connections may point to blocks further in the file, so they are kept in a flat
+ * array and created at the end. Connections the scene refuses, e.g. loops saved by older versions,
+ * are left out and reported by warningString().
+ */
+class SchemeReader
+{
+public:
+    /**
+     * @brief SchemeReader is the constructor.
+     * @param device Open device to read the scheme from.
+     */
+    SchemeReader(QIODevice* device);
+    /**
+     * @brief read parses the whole device into an empty scene.
+     * @param scene Scene to load the scheme into, the caller surrounds the call with beginLoad() and endLoad().
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    bool read(Scene* scene);
+    /**
+     * @brief errorString describes why read() failed, including the line and column of the problem.
+     * @return description of the error.
+     */
+    QString errorString() const;
+    /**
+     * @brief warningString describes the connections read() left out, empty if there are none.
+     * @return description of the skipped connections.
+     */
+    QString warningString() const;
+    /**
+     * @brief read opens a text scheme file and parses it into an empty scene.
+     * A file compressed by CompressedDevice is decompressed while it is parsed.
+     * @param fileName Full path to the file.
+     * @param scene Scene to load the scheme into, the caller surrounds the call with beginLoad() and endLoad().
+     * @param error Description of the problem if the file cannot be read.
+     * @param warning If given, filled with the description of left out connections, see warningString().
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    static bool read(const QString &fileName, Scene* scene, QString* error, QString* warning = NULL);
+private:
+    /**
+     * @brief The Connection struct is a connection waiting until all blocks are created.
+     */
+    struct Connection {
+        int fromId;
+        int toId;
+        int port;
+        int line; /**< line of the file, for error messages.*/
+    };
+
+    enum { BufferSize = 64 * 1024 };
+
+    QIODevice* device; /**< device to read from.*/
+    char buffer[BufferSize]; /**< chunk of the device being parsed.*/
+    int length; /**< number of valid bytes in the buffer.*/
+    int position; /**< next byte to parse in the buffer.*/
+    int line; /**< line of the next byte, starting with 1.*/
+    int column; /**< column of the next byte, starting with 1.*/
+    QString error; /**< description of the last error.*/
+    QString warning; /**< description of the skipped connections.*/
+    int skippedConnections; /**< number of connections refused by the scene.*/
+    bool readFailed; /**< whether reading from the device failed.*/
+    QVector<Connection> connections; /**< connections to create at the end.*/
+
+    int peek();
+    void advance();
+    void skipSpaces();
+    void skipLine();
+    bool readInt(int* value, const char* what);
+    bool readDouble(double* value, const char* what);
+    bool fail(const QString &message);
+    bool fail(int atLine, const QString &message);
+};
+
+#endif // SCHEMEREADER_H
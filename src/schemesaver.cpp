@@ -0,0 +1,104 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the background saver.
+ * @file schemesaver.cpp
+ *
+ *
+ */
+
+#include "schemesaver.h"
+#include "binaryscheme.h"
+#include "compresseddevice.h"
+#include "schemewriter.h"
+
+#include <QFileInfo>
+#include <QtConcurrent>
+
+SchemeSaver::SchemeSaver(QObject* parent) : QObject(parent)
+{
+    savingAutosave = false;
+    savingRevision = 0;
+    progressTimer.setInterval(100);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(reportProgress()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(saveFinished()));
+}
+
+SchemeSaver::~SchemeSaver()
+{
+    watcher.waitForFinished();
+}
+
+void SchemeSaver::save(const SchemeModel &model, const QString &fileName, bool autosave)
+{
+    // Copying the model only shares its chunks, values are left out as the writers do not need them
+    Request request;
+    request.model = model;
+    request.fileName = fileName;
+    request.autosave = autosave;
+    if (!watcher.isRunning()) {
+        start(request);
+        return;
+    }
+
+    // Every explicit save is kept, a newer autosave makes a waiting one useless
+    if (autosave) {
+        for (int i = 0; i < waiting.size(); i++) {
+            if (waiting[i].autosave) {
+                waiting.removeAt(i);
+                break;
+            }
+        }
+    }
+    waiting.append(request);
+}
+
+bool SchemeSaver::isSaving() const
+{
+    return watcher.isRunning() || !waiting.isEmpty();
+}
+
+void SchemeSaver::start(const Request &request)
+{
+    SchemeModel snapshot = request.model;
+    QString fileName = request.fileName;
+    QAtomicInt* progress = &percent;
+    percent.storeRelease(0);
+    savingFile = fileName;
+    savingAutosave = request.autosave;
+    savingRevision = snapshot.revision();
+
+    watcher.setFuture(QtConcurrent::run([snapshot, fileName, progress]() {
+        Result result;
+        QString suffix = QFileInfo(fileName).suffix();
+        if (suffix == BinaryScheme::Suffix)
+            result.saved = BinaryScheme::write(&snapshot, fileName, &result.error, progress);
+        else
+            result.saved = SchemeWriter::write(&snapshot, fileName, &result.error, progress,
+                                               suffix == CompressedDevice::Suffix);
+        return result;
+    }));
+    progressTimer.start();
+}
+
+void SchemeSaver::reportProgress()
+{
+    emit progress(percent.loadAcquire());
+}
+
+void SchemeSaver::saveFinished()
+{
+    progressTimer.stop();
+    Result result = watcher.result();
+    QString fileName = savingFile;
+    bool autosave = savingAutosave;
+    quint64 revision = savingRevision;
+
+    if (!waiting.isEmpty())
+        start(waiting.takeFirst());
+    emit finished(fileName, autosave, revision, result.saved, result.error);
+}
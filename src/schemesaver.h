@@ -0,0 +1,105 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Saving of schemes in the background.
+ * @file schemesaver.h
+ *
+ *
+ */
+
+#ifndef SCHEMESAVER_H
+#define SCHEMESAVER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include "schememodel.h"
+
+/**
+ * @brief The SchemeSaver class writes schemes to files on a worker thread, so the editor does not wait for the disk.
+ *
+ * The saver takes a copy of the model, which shares the chunks of the scheme with the model,
+ * an edit made meanwhile copies only the chunks it changes. The copy is written in the format
+ * given by the suffix of the file, the same way as MainWindow::save() does. Saves requested while
+ * another one runs wait for it in the order of the requests, only a waiting autosave is replaced
+ * by a newer one.
+ */
+class SchemeSaver : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief SchemeSaver is the constructor.
+     * @param parent Parent object.
+     */
+    explicit SchemeSaver(QObject* parent = 0);
+    /**
+     * @brief ~SchemeSaver waits for the running save to finish.
+     */
+    ~SchemeSaver();
+    /**
+     * @brief save starts saving a snapshot of a scheme, or queues it if a save is running.
+     * @param model Model of the scheme, it can be changed as soon as the call returns.
+     * @param fileName Full path to the file.
+     * @param autosave True for an autosave, which is replaced by a newer autosave while it waits.
+     */
+    void save(const SchemeModel &model, const QString &fileName, bool autosave = false);
+    /**
+     * @brief isSaving checks if a save is running or waiting.
+     * @return true if the saver is busy.
+     */
+    bool isSaving() const;
+signals:
+    /**
+     * @brief progress is emitted periodically while a save runs.
+     * @param percent Percentage of the scheme written so far.
+     */
+    void progress(int percent);
+    /**
+     * @brief finished is emitted when a save ends.
+     * @param fileName File the scheme was saved to.
+     * @param autosave True if it was an autosave.
+     * @param revision Revision of the saved snapshot of the model.
+     * @param saved True if the scheme was saved.
+     * @param error Description of the problem if it was not.
+     */
+    void finished(const QString &fileName, bool autosave, quint64 revision, bool saved, const QString &error);
+private slots:
+    void reportProgress();
+    void saveFinished();
+private:
+    /**
+     * @brief The Result struct is the outcome of a save on the worker thread.
+     */
+    struct Result {
+        bool saved; /**< whether the file was written.*/
+        QString error; /**< description of the problem.*/
+    };
+    /**
+     * @brief The Request struct is a save waiting for the running one.
+     */
+    struct Request {
+        SchemeModel model; /**< snapshot of the scheme.*/
+        QString fileName; /**< file to write.*/
+        bool autosave; /**< whether it is an autosave.*/
+    };
+
+    QFutureWatcher<Result> watcher; /**< running save.*/
+    QTimer progressTimer; /**< polls the progress of the running save.*/
+    QAtomicInt percent; /**< progress written by the worker thread.*/
+    QString savingFile; /**< file of the running save.*/
+    bool savingAutosave; /**< whether the running save is an autosave.*/
+    quint64 savingRevision; /**< revision of the snapshot being saved.*/
+    QList<Request> waiting; /**< saves waiting for the running one, in order of the requests.*/
+
+    void start(const Request &request);
+};
+
+#endif // SCHEMESAVER_H
@@ -0,0 +1,137 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Implementation of the text scheme writer.
+ * @file schemewriter.cpp
+ *
+ *
+ */
+
+#include "schemewriter.h"
+#include "compresseddevice.h"
+
+#include <QFile>
+#include <QLocale>
+#include <cstring>
+
+static const char Header[] = "<type> <id> <x> <y> <number_of_outputs> <<next_id><port>> <<next_id><port>> ... "
+                             "[=<input_value>]\n";
+
+SchemeWriter::SchemeWriter(QIODevice* device)
+{
+    this->device = device;
+    storage.resize(BufferSize);
+    buffer = storage.data();
+    length = 0;
+    failed = false;
+    progress = NULL;
+}
+
+void SchemeWriter::setProgress(QAtomicInt* progress)
+{
+    this->progress = progress;
+}
+
+bool SchemeWriter::write(const SchemeModel* model, const QString &fileName, QString* error,
+                         QAtomicInt* progress, bool compressed)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    CompressedDevice compressor(&file);
+    QIODevice* device = &file;
+    if (compressed) {
+        if (!compressor.open(QIODevice::WriteOnly)) {
+            *error = compressor.errorString();
+            return false;
+        }
+        device = &compressor;
+    }
+
+    SchemeWriter writer(device);
+    writer.setProgress(progress);
+    if (!writer.write(model) || (compressed && !compressor.finish())) {
+        *error = device->errorString();
+        return false;
+    }
+    file.close();
+    return true;
+}
+
+bool SchemeWriter::write(const SchemeModel* model)
+{
+    append(Header, sizeof(Header) - 1);
+
+    for (int slot = 0; slot < model->slotCount() && !failed; slot++) {
+        const SchemeModel::BlockRecord& block = model->blockAt(slot);
+        if (block.id < 0)
+            continue;
+
+        appendInt(block.type);
+        appendInt(block.id);
+        appendInt(block.x);
+        appendInt(block.y);
+        appendInt(int(block.outEdges.size()));
+        // Every edge knows its input port, so repeated next blocks keep their ports
+        for (size_t i = 0; i < block.outEdges.size(); i++) {
+            const SchemeModel::Edge& edge = model->edgeAt(block.outEdges[i]);
+            appendInt(model->blockAt(edge.to).id);
+            appendInt(edge.toPort);
+        }
+        if (block.type == SchemeModel::Input && block.inputSet) {
+            // Shortest text that reads back as the same double
+            QByteArray value = QString::number(block.inputValue, 'g', QLocale::FloatingPointShortest).toLatin1();
+            append("=", 1);
+            append(value.constData(), value.size());
+        }
+        append("\n", 1);
+        if (progress && (slot & 4095) == 0)
+            progress->storeRelease(int(qint64(slot) * 100 / model->slotCount()));
+    }
+
+    flush();
+    return !failed;
+}
+
+void SchemeWriter::append(const char* text, int size)
+{
+    if (length + size > BufferSize)
+        flush();
+    memcpy(buffer + length, text, size);
+    length += size;
+}
+
+void SchemeWriter::appendInt(int value)
+{
+    // Longest int with its sign and the separating space fits into 12 bytes
+    if (length + 12 > BufferSize)
+        flush();
+
+    char digits[10];
+    int count = 0;
+    unsigned int magnitude = value < 0 ? 0u - unsigned(value) : unsigned(value);
+    do {
+        digits[count++] = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0)
+        buffer[length++] = '-';
+    while (count)
+        buffer[length++] = digits[--count];
+    buffer[length++] = ' ';
+}
+
+void SchemeWriter::flush()
+{
+    if (length && !failed && device->write(buffer, length) != length)
+        failed = true;
+    length = 0;
+}
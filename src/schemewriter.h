@@ -0,0 +1,75 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Buffered writer of the text format of a scheme file.
+ * @file schemewriter.h
+ *
+ *
+ */
+
+#ifndef SCHEMEWRITER_H
+#define SCHEMEWRITER_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include "schememodel.h"
+
+/**
+ * @brief The SchemeWriter class writes a scheme in the text format read by SchemeReader.
+ *
+ * The blocks and their connections are taken from the model in a single pass over its edges.
+ * Numbers are formatted straight into a reusable buffer, which is written to the device
+ * whenever it fills up.
+ */
+class SchemeWriter
+{
+public:
+    /**
+     * @brief SchemeWriter is the constructor.
+     * @param device Open device to write the scheme to.
+     */
+    SchemeWriter(QIODevice* device);
+    /**
+     * @brief setProgress sets where write() reports the percentage of the blocks written so far.
+     * @param progress Counter updated while writing, may be read from another thread.
+     */
+    void setProgress(QAtomicInt* progress);
+    /**
+     * @brief write writes the whole scheme to the device.
+     * @param model Model of the scheme.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    bool write(const SchemeModel* model);
+    /**
+     * @brief write saves a scheme to a text file.
+     * @param model Model of the scheme.
+     * @param fileName Full path to the file.
+     * @param error Description of the problem if the file cannot be written.
+     * @param progress If given, receives the percentage of the blocks written so far.
+     * @param compressed Whether to write the text into a CompressedDevice.
+     * @return Returns true if operation was succesful, false otherwise.
+     */
+    static bool write(const SchemeModel* model, const QString &fileName, QString* error,
+                      QAtomicInt* progress = NULL, bool compressed = false);
+private:
+    enum { BufferSize = 256 * 1024 };
+
+    QIODevice* device; /**< device to write to.*/
+    QByteArray storage; /**< heap memory of the buffer, the writer also runs on worker threads with small stacks.*/
+    char* buffer; /**< bytes not written to the device yet, BufferSize bytes of storage.*/
+    int length; /**< number of bytes in the buffer.*/
+    bool failed; /**< whether a write to the device failed.*/
+    QAtomicInt* progress; /**< percentage of the written blocks, may be NULL.*/
+
+    void append(const char* text, int size);
+    void appendInt(int value);
+    void flush();
+};
+
+#endif // SCHEMEWRITER_H
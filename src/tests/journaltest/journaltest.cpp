@@ -0,0 +1,124 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Tests of journals saved next to scheme files.
+ * @file journaltest.cpp
+ *
+ *
+ */
+
+#include <QtTest>
+#include <QTemporaryDir>
+#include "mainwindow.h"
+#include "scene.h"
+#include "binaryscheme.h"
+#include "schemereader.h"
+#include "schemejournal.h"
+#include "schemewriter.h"
+#include "model/schememodel.h"
+
+/**
+ * @brief The JournalTest class tests how the main window keeps journals in step with scheme files.
+ */
+class JournalTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void compactedFileDropsJournal();
+    void inputValuesAreSaved();
+};
+
+/**
+ * @brief writeScheme writes a scheme of unconnected Input blocks.
+ * @param fileName Full path to the file.
+ * @param blocks Number of blocks.
+ * @return Returns true if operation was succesful, false otherwise.
+ */
+static bool writeScheme(const QString &fileName, int blocks)
+{
+    SchemeModel model;
+    for (int i = 0; i < blocks; i++)
+        model.addBlock(SchemeModel::Input, i, 100 * i, 0);
+    QString error;
+    return SchemeWriter::write(&model, fileName, &error);
+}
+
+void JournalTest::compactedFileDropsJournal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString first = dir.filePath("first.txt");
+    QString second = dir.filePath("second.txt");
+    QVERIFY(writeScheme(first, 2));
+    QVERIFY(writeScheme(second, 1));
+
+    // The journal of the first scheme adds a block the file does not have
+    QString error;
+    QString warning;
+    SchemeModel edited;
+    SchemeJournal edits(&edited);
+    edited.setListener(&edits);
+    QVERIFY(edited.addBlock(SchemeModel::Output, 10, 0, 100));
+    QVERIFY2(edits.save(SchemeJournal::fileName(first), &error), qPrintable(error));
+    edited.setListener(NULL);
+
+    MainWindow window;
+    QVERIFY2(window.openFile(first, &error, &warning), qPrintable(error));
+
+    // The save reports back through the event loop, so it always finishes after the second file is open
+    window.saveWhole(first);
+    QVERIFY2(window.openFile(second, &error, &warning), qPrintable(error));
+    QTRY_VERIFY(!window.isSaving());
+
+    // The block from the journal is in the file now, replaying it again would add it twice
+    QVERIFY(!QFile::exists(SchemeJournal::fileName(first)));
+    QVERIFY2(window.openFile(first, &error, &warning), qPrintable(error));
+}
+
+void JournalTest::inputValuesAreSaved()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString text = dir.filePath("values.txt");
+    QString binary = dir.filePath("values.bsch");
+
+    SchemeModel model;
+    QVERIFY(model.addBlock(SchemeModel::Input, 0, 0, 0));
+    QVERIFY(model.addBlock(SchemeModel::Input, 1, 100, 0));
+    model.setInputValue(0, 0.1);
+
+    // The saver writes a snapshot, which has no calculated values
+    SchemeModel snapshot(model);
+    QString error;
+    QVERIFY2(SchemeWriter::write(&snapshot, text, &error), qPrintable(error));
+    QVERIFY2(BinaryScheme::write(&snapshot, binary, &error), qPrintable(error));
+
+    // A value set afterwards goes to the journal of the text file
+    SchemeJournal edits(&model);
+    model.setListener(&edits);
+    model.setInputValue(1, -2.5e300);
+    QVERIFY2(edits.save(SchemeJournal::fileName(text), &error), qPrintable(error));
+    model.setListener(NULL);
+
+    Scene fromText;
+    fromText.beginLoad();
+    QVERIFY2(SchemeReader::read(text, &fromText, &error), qPrintable(error));
+    QVERIFY2(SchemeJournal::replay(SchemeJournal::fileName(text), &fromText, &error), qPrintable(error));
+    fromText.endLoad();
+    QCOMPARE(fromText.schemeModel()->value(0), 0.1);
+    QCOMPARE(fromText.schemeModel()->value(1), -2.5e300);
+
+    Scene fromBinary;
+    fromBinary.beginLoad();
+    QVERIFY2(BinaryScheme::read(binary, &fromBinary, &error), qPrintable(error));
+    fromBinary.endLoad();
+    QCOMPARE(fromBinary.schemeModel()->value(0), 0.1);
+    QVERIFY(!fromBinary.schemeModel()->hasValue(1));
+}
+
+QTEST_MAIN(JournalTest)
+#include "journaltest.moc"
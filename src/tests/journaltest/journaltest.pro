@@ -0,0 +1,45 @@
+TEMPLATE = app
+TARGET = journaltest
+
+QT += core gui concurrent widgets testlib
+CONFIG += c++14 testcase
+
+APP = $$PWD/../..
+INCLUDEPATH += $$APP
+DEPENDPATH += $$APP
+
+SOURCES += \
+    journaltest.cpp \
+    $$APP/mainwindow.cpp \
+    $$APP/scene.cpp \
+    $$APP/block.cpp \
+    $$APP/blockconnection.cpp \
+    $$APP/port.cpp \
+    $$APP/line.cpp \
+    $$APP/binaryscheme.cpp \
+    $$APP/schemereader.cpp \
+    $$APP/schemewriter.cpp \
+    $$APP/schemesaver.cpp \
+    $$APP/schemejournal.cpp \
+    $$APP/compresseddevice.cpp \
+    $$APP/edgelayer.cpp
+
+HEADERS += \
+    $$APP/mainwindow.h \
+    $$APP/scene.h \
+    $$APP/block.h \
+    $$APP/blockconnection.h \
+    $$APP/port.h \
+    $$APP/line.h \
+    $$APP/binaryscheme.h \
+    $$APP/schemereader.h \
+    $$APP/schemewriter.h \
+    $$APP/schemesaver.h \
+    $$APP/schemejournal.h \
+    $$APP/compresseddevice.h \
+    $$APP/edgelayer.h
+
+include($$APP/model/model.pri)
+
+RESOURCES += \
+    $$APP/blockeditor.qrc
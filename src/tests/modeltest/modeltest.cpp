@@ -0,0 +1,195 @@
+/**
+ * Course ICP @ FIT VUT Brno, 2018
+ * ICP 2018 Project - blockeditor
+ *
+ * @author David Hás, xhasda00
+ * @author Ksenia Bolshakova, xbolsh00
+ *
+ * @brief Tests of the headless model and its evaluators.
+ * @file modeltest.cpp
+ *
+ *
+ */
+
+#include "schememodel.h"
+#include "batchevaluator.h"
+#include "parallelevaluator.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * @brief sameColumns compares two columns bit by bit, so equal nans match and 0 differs from -0.
+ * @param a First column.
+ * @param b Second column.
+ * @param rows Number of rows.
+ * @return true if the columns are the same.
+ */
+static bool sameColumns(const double* a, const double* b, size_t rows)
+{
+    return a && b && std::memcmp(a, b, rows * sizeof(double)) == 0;
+}
+
+/**
+ * @brief buildLayers builds a scheme of layers of blocks, each block reads two blocks of the layer before.
+ * @param model Empty model.
+ * @param inputs Number of Input blocks, ids 0 and up.
+ * @param layers Number of layers after the inputs.
+ * @param width Number of blocks of a layer.
+ * @return ids of the Output blocks, one for each block of the last layer.
+ */
+static std::vector<int> buildLayers(SchemeModel* model, int inputs, int layers, int width)
+{
+    static const SchemeModel::BlockType types[] = {
+        SchemeModel::Add, SchemeModel::Sub, SchemeModel::Mul, SchemeModel::Sqrt, SchemeModel::Pow2
+    };
+    int id = 0;
+    std::vector<int> previous;
+    for (int i = 0; i < inputs; i++) {
+        model->addBlock(SchemeModel::Input, id);
+        previous.push_back(id++);
+    }
+    for (int layer = 0; layer < layers; layer++) {
+        std::vector<int> current;
+        for (int i = 0; i < width; i++) {
+            SchemeModel::BlockType type = types[(layer * width + i) % 5];
+            model->addBlock(type, id);
+            model->connect(previous[i % previous.size()], id, 0);
+            if (SchemeModel::inPortCount(type) > 1)
+                model->connect(previous[(i + 1) % previous.size()], id, 1);
+            current.push_back(id++);
+        }
+        previous = current;
+    }
+    std::vector<int> outputs;
+    for (size_t i = 0; i < previous.size(); i++) {
+        model->addBlock(SchemeModel::Output, id);
+        model->connect(previous[i], id, 0);
+        outputs.push_back(id++);
+    }
+    return outputs;
+}
+
+static void parallelMatchesSerial()
+{
+    SchemeModel model;
+    const int inputs = 4;
+    std::vector<int> outputs = buildLayers(&model, inputs, 12, 16);
+
+    // Small rows over and under the cutoff, both paths of the parallel evaluator
+    const size_t sizes[] = { 100, 20001 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t rows = sizes[s];
+        std::vector<std::vector<double> > columns(inputs, std::vector<double>(rows));
+        for (int i = 0; i < inputs; i++) {
+            for (size_t row = 0; row < rows; row++)
+                columns[i][row] = std::sin(double(row * (i + 1))) * 1.5;
+        }
+
+        BatchEvaluator serial(&model);
+        ParallelEvaluator parallel(&model, 4);
+        for (int i = 0; i < inputs; i++) {
+            CHECK(serial.bindInput(i, columns[i].data()));
+            CHECK(parallel.bindInput(i, columns[i].data()));
+        }
+
+        SchemeModel::EvalError serialErr = SchemeModel::NoErr;
+        SchemeModel::EvalError parallelErr = SchemeModel::DivByZero;
+        CHECK(serial.run(rows, &serialErr));
+        // Repeated runs reuse the parked threads, the error of a run does not depend on an earlier value
+        for (int run = 0; run < 3; run++) {
+            CHECK(parallel.run(rows, &parallelErr));
+            CHECK(parallelErr == serialErr);
+            for (size_t i = 0; i < outputs.size(); i++)
+                CHECK(sameColumns(serial.column(outputs[i]), parallel.column(outputs[i]), rows));
+        }
+        CHECK(serialErr == SchemeModel::NoErr);
+
+        // The batch result of a row is what the model calculates for it alone
+        size_t row = rows / 2;
+        for (int i = 0; i < inputs; i++)
+            model.setInputValue(i, columns[i][row]);
+        CHECK(model.evaluateAll() == SchemeModel::NoErr);
+        for (size_t i = 0; i < outputs.size(); i++) {
+            double expected = model.value(outputs[i]);
+            double actual = parallel.column(outputs[i])[row];
+            CHECK(expected == actual || (std::isnan(expected) && std::isnan(actual)));
+        }
+    }
+}
+
+static void kernelsMatchScalar()
+{
+    static const SchemeModel::BlockType types[] = {
+        SchemeModel::Add, SchemeModel::Sub, SchemeModel::Mul, SchemeModel::Div,
+        SchemeModel::Pow2, SchemeModel::PowX, SchemeModel::Sqrt
+    };
+    // An odd number of rows leaves a tail after the vectors of both SSE2 and AVX2
+    const size_t rows = 103;
+    std::vector<double> a(rows);
+    std::vector<double> b(rows);
+    for (size_t row = 0; row < rows; row++) {
+        a[row] = (double(row) - 50) / 7;
+        b[row] = row % 9 == 4 ? 0 : (double(row) - 40) / 3;
+    }
+    b[2] = -0.0;
+
+    BatchEvaluator::Isa best = BatchEvaluator::detectIsa();
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+        SchemeModel model;
+        model.addBlock(SchemeModel::Input, 0);
+        model.addBlock(SchemeModel::Input, 1);
+        model.addBlock(types[t], 2);
+        model.addBlock(SchemeModel::Output, 3);
+        model.connect(0, 2, 0);
+        if (SchemeModel::inPortCount(types[t]) > 1)
+            model.connect(1, 2, 1);
+        model.connect(2, 3, 0);
+
+        BatchEvaluator scalar(&model);
+        scalar.setIsa(BatchEvaluator::Scalar);
+        CHECK(scalar.bindInput(0, a.data()));
+        CHECK(scalar.bindInput(1, b.data()));
+        SchemeModel::EvalError scalarErr;
+        CHECK(scalar.run(rows, &scalarErr));
+        CHECK(scalarErr == (types[t] == SchemeModel::Div ? SchemeModel::DivByZero : SchemeModel::NoErr));
+
+        for (int isa = BatchEvaluator::SSE2; isa <= best; isa++) {
+            BatchEvaluator vector(&model);
+            vector.setIsa(BatchEvaluator::Isa(isa));
+            CHECK(vector.bindInput(0, a.data()));
+            CHECK(vector.bindInput(1, b.data()));
+            SchemeModel::EvalError err = SchemeModel::DivByZero;
+            CHECK(vector.run(rows, &err));
+            CHECK(err == scalarErr);
+            CHECK(sameColumns(scalar.column(3), vector.column(3), rows));
+
+            // The first row has no zero divisor, the error of the previous run must not stay
+            CHECK(vector.run(1, &err));
+            CHECK(err == SchemeModel::NoErr);
+        }
+    }
+}
+
+int main()
+{
+    parallelMatchesSerial();
+    kernelsMatchScalar();
+    if (failures)
+        std::printf("%d check(s) failed\n", failures);
+    else
+        std::printf("All checks passed\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,10 @@
+TEMPLATE = app
+TARGET = modeltest
+
+CONFIG += console c++14 thread testcase
+CONFIG -= qt app_bundle
+
+include(../../model/model.pri)
+
+SOURCES += \
+    modeltest.cpp